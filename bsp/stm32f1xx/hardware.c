@@ -42,6 +42,9 @@ static void hw_setup_systick(void)
     systick_counter_enable();
 }
 
+#define HW_CYCLES_PER_TICK  (72000000 / SYSTEM_TICKS_PRE_SEC)
+#define HW_IDLE_TICKS_MAX   (0xFFFFFF / HW_CYCLES_PER_TICK)   // 24 bits reload
+
 /* systick interrupt handle routing  */
 void sys_tick_handler(void)
 {
@@ -136,6 +139,7 @@ void hw_setup(hw_info_t *info)
     hw_setup_timer();
     hw_setup_storage();
     hw_setup_systick();
+    dwt_enable_cycle_counter();
 
     hw_info_get(info);
 }
@@ -164,6 +168,52 @@ void hw_poll(void)
     hw_poll_usb();
 }
 
+/* Stretch systick period over the whole sleep, and account the ticks
+ * passed at wake up. Part of a tick is lost if woke by other interrupt.
+ */
+void hw_idle(uint32_t max_ticks)
+{
+    uint32_t reload, passed;
+
+    if (max_ticks > HW_IDLE_TICKS_MAX) {
+        max_ticks = HW_IDLE_TICKS_MAX;
+    }
+
+    if (max_ticks < 2) {
+        __asm__ volatile ("wfi");
+        return;
+    }
+
+    reload = HW_CYCLES_PER_TICK * max_ticks - 1;
+
+    systick_counter_disable();
+    systick_set_reload(reload);
+    systick_clear();
+    systick_get_countflag();
+    systick_counter_enable();
+
+    __asm__ volatile ("wfi");
+
+    if (systick_get_countflag()) {
+        // Systick handler is pending, and will count the last one
+        passed = max_ticks - 1;
+    } else {
+        passed = (reload - systick_get_value()) / HW_CYCLES_PER_TICK;
+    }
+
+    systick_counter_disable();
+    systick_set_reload(HW_CYCLES_PER_TICK - 1);
+    systick_clear();
+    systick_counter_enable();
+
+    _cupkee_systicks += passed;
+}
+
+uint32_t hw_cycle_count(void)
+{
+    return dwt_read_cycle_counter();
+}
+
 void hw_halt(void)
 {
     while (1)
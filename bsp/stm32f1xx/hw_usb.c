@@ -388,10 +388,21 @@ void hw_setup_usb(void)
 
     //_usbd_reset(usb_hnd);
     cupkee_device_register(&hw_device_cdc);
+
+    nvic_enable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+}
+
+/* USB is served by usbd_poll in main loop, the interrupt only wakes
+ * the loop from hw_idle, and is masked until next poll.
+ */
+void usb_lp_can_rx0_isr(void)
+{
+    nvic_disable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
 }
 
 void hw_poll_usb(void)
 {
     usbd_poll(usb_hnd);
+    nvic_enable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
 }
 
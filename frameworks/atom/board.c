@@ -38,6 +38,10 @@ static const native_t board_entries[] = {
     {"pinGroup",        native_pin_group},
     {"toggle",          native_pin_toggle},
 
+    {"on",              native_topic_on},
+    {"off",             native_topic_off},
+    {"emit",            native_topic_emit},
+
     {"setTimeout",      native_set_timeout},
     {"setInterval",     native_set_interval},
     {"clearTimeout",    native_clear_timeout},
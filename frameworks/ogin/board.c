@@ -140,6 +140,8 @@ static cupkee_command_entry_t command_entries[] = {
     {"hello", command_hello},
     {"read",  command_i2c_read},
     {"write", command_i2c_write},
+    {"memory", cupkee_command_memory},
+    {"profile", cupkee_command_profile},
 };
 
 int board_commands(void)
@@ -30,9 +30,14 @@
 #include "cupkee_utils.h"
 #include "cupkee_data.h"
 #include "cupkee_memory.h"
+#include "cupkee_pool.h"
+#include "cupkee_arena.h"
 #include "cupkee_buffer.h"
 #include "cupkee_storage.h"
+#include "cupkee_timeout.h"
 #include "cupkee_event.h"
+#include "cupkee_defer.h"
+#include "cupkee_profile.h"
 #include "cupkee_vector.h"
 #include "cupkee_stream.h"
 #include "cupkee_block.h"
@@ -43,9 +48,9 @@
 #include "cupkee_console.h"
 
 #include "cupkee_pin.h"
+#include "cupkee_topic.h"
 #include "cupkee_timer.h"
 
-#include "cupkee_timeout.h"
 #include "cupkee_device.h"
 #include "cupkee_auto_complete.h"
 #include "cupkee_history.h"
@@ -55,6 +60,7 @@
 void cupkee_init(const uint8_t *id);
 void cupkee_loop(void);
 void cupkee_event_poll(void);
+void cupkee_idle(void);
 
 static inline void cupkee_start(void) {
     _cupkee_systicks = 0;
@@ -0,0 +1,48 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#ifndef __CUPKEE_ARENA_INC__
+#define __CUPKEE_ARENA_INC__
+
+/* Bump pointer allocator for temporaries of one transaction
+ *
+ * Memory is taken from page allocator by chunk, and only given back
+ * all together by reset. Objects can not be freed one by one.
+ */
+typedef struct cupkee_arena_t {
+    list_head_t chunks;
+    uint32_t    off;        // used bytes of the last chunk
+    uint8_t     order;      // minimum order of chunks
+    uint8_t     tag;        // allocation tag of chunks
+} cupkee_arena_t;
+
+typedef struct cupkee_arena_mark_t {
+    cupkee_page_t *chunk;
+    uint32_t       off;
+} cupkee_arena_mark_t;
+
+void  cupkee_arena_init(cupkee_arena_t *arena, int order, int tag);
+void *cupkee_arena_alloc(cupkee_arena_t *arena, size_t size);
+
+void  cupkee_arena_mark(cupkee_arena_t *arena, cupkee_arena_mark_t *mark);
+void  cupkee_arena_reset_to(cupkee_arena_t *arena, const cupkee_arena_mark_t *mark);
+void  cupkee_arena_reset(cupkee_arena_t *arena);
+
+#endif /* __CUPKEE_ARENA_INC__ */
+
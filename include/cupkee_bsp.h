@@ -65,6 +65,13 @@ void hw_reset(int mode);
 
 void hw_poll(void);
 void hw_halt(void);
+/* Sleep until an interrupt or max_ticks systicks elapsed, _cupkee_systicks
+ * should be kept up to date. Called with interrupts masked, and should wake
+ * on any interrupt pending.
+ */
+void hw_idle(uint32_t max_ticks);
+/* Free running counter of cpu cycles, for profiling */
+uint32_t hw_cycle_count(void);
 int  hw_boot_state(void);
 
 void hw_enter_critical(uint32_t *state);
@@ -47,8 +47,8 @@ static inline void cupkee_buffer_init(cupkee_buffer_t *b, size_t size, void *ptr
     b->bgn = 0;
 }
 
-static inline int cupkee_buffer_alloc(cupkee_buffer_t *b, size_t size) {
-    void *ptr = cupkee_malloc(size);
+static inline int cupkee_buffer_alloc_tagged(cupkee_buffer_t *b, size_t size, int tag) {
+    void *ptr = cupkee_malloc_tagged(size, tag);
 
     if (ptr) {
         b->flags = CUPKEE_FLAG_OWNED;
@@ -62,6 +62,25 @@ static inline int cupkee_buffer_alloc(cupkee_buffer_t *b, size_t size) {
     }
 }
 
+static inline int cupkee_buffer_alloc_aligned(cupkee_buffer_t *b, size_t size, size_t align) {
+    void *ptr = cupkee_malloc_aligned(size, align);
+
+    if (ptr) {
+        b->flags = CUPKEE_FLAG_OWNED;
+        b->ptr = ptr;
+        b->cap = size;
+        b->bgn = b->len = 0;
+        return size;
+    } else {
+        cupkee_buffer_reset(b);
+        return 0;
+    }
+}
+
+static inline int cupkee_buffer_alloc(cupkee_buffer_t *b, size_t size) {
+    return cupkee_buffer_alloc_tagged(b, size, CUPKEE_MTAG_NONE);
+}
+
 static inline void cupkee_buffer_deinit(cupkee_buffer_t *b) {
     if ((b->flags & CUPKEE_FLAG_OWNED) && b->ptr) {
         cupkee_free(b->ptr);
@@ -96,6 +115,7 @@ static inline void *cupkee_buffer_ptr(cupkee_buffer_t *b) {
 int cupkee_buffer_xxx(cupkee_buffer_t *b, void **pptr);
 
 int cupkee_buffer_space_to(cupkee_buffer_t *b, size_t n);
+int cupkee_buffer_space_to_tagged(cupkee_buffer_t *b, size_t n, int tag);
 
 int cupkee_buffer_set(cupkee_buffer_t *b, int offset, uint8_t d);
 int cupkee_buffer_get(cupkee_buffer_t *b, int offset, uint8_t *d);
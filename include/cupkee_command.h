@@ -30,5 +30,9 @@ int cupkee_command_init(int command_num, cupkee_command_entry_t *command_entrys,
                         int command_buf_size, char *command_buf);
 int cupkee_command_handle(int type, int ch);
 
+// Builtin command handlers, for the command table of application
+int cupkee_command_memory(int ac, char **av);
+int cupkee_command_profile(int ac, char **av);
+
 #endif /* __CUPKEE_COMMAND_INC__ */
 
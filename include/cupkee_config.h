@@ -20,22 +20,78 @@
 #ifndef __CUPKEE_CONFIG_INC__
 #define __CUPKEE_CONFIG_INC__
 
+// Object
+#define CUPKEE_OBJECT_TAG_MAX           16
+// Object map starts with NUM_DEF ids, and grows up to NUM_MAX ids
+#define CUPKEE_OBJECT_NUM_DEF           32
+#define CUPKEE_OBJECT_NUM_MAX           256
+// Entries of property lookup cache, should be power of 2
+#define CUPKEE_PROP_CACHE_SIZE          32
+
 // Device
 #define CUPKEE_DEVICE_TYPE_MAX          16
 
 // Pin
 #define CUPKEE_PIN_MAX                  32
 
+// Event
+#define CUPKEE_EVENTQ_SIZE              16   // should be power of 2
+#define CUPKEE_EVENTQ_URGENT_SIZE       8    // should be power of 2
+#define CUPKEE_EVENT_NORMAL_BUDGET      4    // normal events handled by each poll
+
+// Topics of publish/subscribe, and subscribers of all topics
+#define CUPKEE_TOPIC_MAX                16
+#define CUPKEE_TOPIC_SUBSCRIBERS        16
+
+// Deferred works queued by ISRs and drivers, and run by each poll
+#define CUPKEE_DEFER_SIZE               16   // should be power of 2
+#define CUPKEE_DEFER_BUDGET             8
+
+// Dispatch latency histograms, take hw_cycle_count at each post
+#ifndef CUPKEE_EVENT_PROFILE
+#define CUPKEE_EVENT_PROFILE            0
+#endif
+#define CUPKEE_EVENT_PROFILE_BUCKETS    24   // last bucket: 2^22 cycles and above
+
+// Longest sleep of idle loop in systicks, also when nothing scheduled
+#define CUPKEE_IDLE_TICKS_MAX           1000
+#define CUPKEE_EVENT_COALESCE_IDS       32   // objects whose DATA/DRAIN events are coalesced
+
 // Memory
-#define CUPKEE_ZONE_MAX                 2
+#define CUPKEE_ZONE_MAX                 4    // limited by zone id bits of page flags
 
 #define CUPKEE_PAGE_SHIFT               (10)
 #define CUPKEE_PAGE_SIZE                (1U << CUPKEE_PAGE_SHIFT)
 #define CUPKEE_PAGE_MASK                (((intptr_t)(-1)) << CUPKEE_PAGE_SHIFT)
 #define CUPKEE_PAGE_ORDERR_MAX          (8)
 
-#define CUPKEE_MUNIT_SHIFT              (5)
+#define CUPKEE_MUNIT_SHIFT              (3)
 #define CUPKEE_MUNIT_SIZE               (1U << CUPKEE_MUNIT_SHIFT)
 
+// Block size classes of cupkee_malloc, ascending order and multiple of CUPKEE_MUNIT_SIZE, up to 16 classes.
+// Request bigger than the last one is served by whole pages.
+#define CUPKEE_MBLOCK_SIZES             16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512
+
+// Empty pages kept by each block size class, before give back to page allocator
+#define CUPKEE_MBCQ_WARM_PAGES          1
+
+// Alignment and size granularity of cupkee_dma_alloc, should not exceed CUPKEE_PAGE_SIZE
+#define CUPKEE_DMA_ALIGN                32
+
+// Timeout wheel: 2^WHEEL_BITS one tick slots, then LEVELS - 1 levels of 2^LEVEL_BITS slots
+#define CUPKEE_TIMEOUT_WHEEL_BITS       5
+#define CUPKEE_TIMEOUT_LEVEL_BITS       4
+#define CUPKEE_TIMEOUT_LEVELS           4
+// Timeout map starts with NUM_DEF timers, and grows up to MAX concurrent timers
+#define CUPKEE_TIMEOUT_NUM_DEF          8
+#ifndef CUPKEE_TIMEOUT_MAX
+#define CUPKEE_TIMEOUT_MAX              1024
+#endif
+
+// Objects taken by each refill of kernel object pools
+#define CUPKEE_PIN_HANDLE_POOL_GROW     4
+#define CUPKEE_PROCESS_POOL_GROW        4
+#define CUPKEE_STREAM_POOL_GROW         2
+
 #endif /* __CUPKEE_CONFIG_INC__ */
 
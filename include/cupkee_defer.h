@@ -0,0 +1,45 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#ifndef __CUPKEE_DEFER_INC__
+#define __CUPKEE_DEFER_INC__
+
+/* Deferred work (bottom halves)
+ *
+ * ISRs and driver callbacks queue a function to be called later by the main
+ * loop, in cupkee_event_poll. Queue is preallocated, so it is safe to use in
+ * interrupt context, and a defer fails when queue is full.
+ */
+typedef void (*cupkee_defer_fn_t)(void *arg);
+
+typedef struct cupkee_defer_stat_t {
+    uint32_t depth_max; // high-water mark of queued works
+    uint32_t drops;     // defer failed for queue full
+    uint32_t runs;
+} cupkee_defer_stat_t;
+
+void cupkee_defer_setup(void);
+
+int  cupkee_defer(cupkee_defer_fn_t fn, void *arg);
+int  cupkee_defer_run(int budget);
+int  cupkee_defer_pending(void);
+void cupkee_defer_stat(cupkee_defer_stat_t *stat);
+
+#endif /* __CUPKEE_DEFER_INC__ */
+
@@ -63,6 +63,7 @@ struct cupkee_device_t {
 
     cupkee_buffer_t req_buf;
     cupkee_buffer_t res_buf;
+    cupkee_arena_t  req_arena;  // temporaries of current query
 
     const cupkee_driver_t *driver;
 
@@ -74,6 +75,7 @@ int cupkee_device_setup(void);
 int cupkee_device_tag(void);
 void cupkee_device_sync(uint32_t systicks);
 void cupkee_device_poll(void);
+uint32_t cupkee_device_next(uint32_t systicks);
 int  cupkee_device_register(const cupkee_device_desc_t *desc);
 
 void *cupkee_device_request(const char *name, int instance);
@@ -23,7 +23,15 @@
 enum CUPKEE_EVENT_TYPE {
     EVENT_SYSTICK = 0,
     EVENT_OBJECT  = 1,
-    EVENT_PIN     = 2
+    EVENT_PIN     = 2,
+    EVENT_TOPIC   = 3,
+    EVENT_TYPE_MAX
+};
+
+enum CUPKEE_EVENT_PRIO {
+    EVENT_PRIO_URGENT = 0,      // I/O completion, systick
+    EVENT_PRIO_NORMAL = 1,      // application events
+    EVENT_PRIO_MAX
 };
 
 enum CUPKEE_EVENT_OBJECT {
@@ -59,6 +67,10 @@ typedef struct cupkee_event_t {
     uint8_t type;
     uint8_t code;
     uint16_t which;
+    uint32_t data;      // payload: timestamp, byte count or error code
+#if CUPKEE_EVENT_PROFILE
+    uint32_t stamp;     // hw_cycle_count at post
+#endif
 } cupkee_event_t;
 
 typedef int  (*cupkee_event_handle_t)(cupkee_event_t *);
@@ -66,15 +78,31 @@ typedef int  (*cupkee_event_handle_t)(cupkee_event_t *);
 void cupkee_event_setup(void);
 void cupkee_event_reset(void);
 
-int cupkee_event_post(uint8_t type, uint8_t code, uint16_t which);
+/* Coalesced event delivers payload of the latest post */
+int cupkee_event_post_ext(uint8_t prio, uint8_t type, uint8_t code, uint16_t which, uint32_t data);
+int cupkee_event_take_prio(uint8_t prio, cupkee_event_t *event);
 int cupkee_event_take(cupkee_event_t *event);
+int cupkee_event_pending(void);
+uint32_t cupkee_event_drops(uint8_t type);
+
+/* Payload of the event last taken, for handlers called in its dispatch */
+uint32_t cupkee_event_data(void);
+
+static inline int cupkee_event_post_prio(uint8_t prio, uint8_t type, uint8_t code, uint16_t which) {
+    return cupkee_event_post_ext(prio, type, code, which, 0);
+}
+
+static inline int cupkee_event_post(uint8_t type, uint8_t code, uint16_t which) {
+    return cupkee_event_post_ext(EVENT_PRIO_NORMAL, type, code, which, 0);
+}
 
 static inline int cupkee_event_post_systick(void) {
-    return cupkee_event_post(EVENT_SYSTICK, 0, 0);
+    return cupkee_event_post_ext(EVENT_PRIO_URGENT, EVENT_SYSTICK, 0, 0, _cupkee_systicks);
 }
 
+// Payload: systicks of the edge
 static inline int cupkee_event_post_pin(uint8_t which, uint8_t event) {
-    return cupkee_event_post(EVENT_PIN, event, which);
+    return cupkee_event_post_ext(EVENT_PRIO_NORMAL, EVENT_PIN, event, which, _cupkee_systicks);
 }
 
 #endif /* __CUPKEE_EVENT_INC__ */
@@ -25,24 +25,73 @@ typedef struct cupkee_page_t {
 
     uint8_t flags;
     uint8_t used;
-    uint16_t order;
+    uint8_t order;
+    uint8_t mbcq;
 
     intptr_t blocks;
 } cupkee_page_t;
 
+typedef struct cupkee_memory_stat_t {
+    uint16_t block_size;
+    uint16_t block_num;
+    uint16_t block_used;
+    uint16_t pages;
+} cupkee_memory_stat_t;
+
+typedef struct cupkee_memory_info_t {
+    uint16_t page_total;
+    uint16_t page_free;
+    uint16_t page_peak;         // high-water mark of pages in use
+    int8_t   free_order_max;    // order of the largest free pages, -1 if none
+    uint16_t slab_pages;        // pages held by block size classes
+    uint32_t slab_used;         // bytes of blocks in use
+    uint16_t alloc_fail;        // cupkee_malloc failures
+} cupkee_memory_info_t;
+
+/* Allocation tags, to account memory of subsystems */
+enum cupkee_memory_tag_e {
+    CUPKEE_MTAG_NONE = 0,
+    CUPKEE_MTAG_STREAM,
+    CUPKEE_MTAG_SHELL,
+    CUPKEE_MTAG_SDMP,
+    CUPKEE_MTAG_DEVICE,
+    CUPKEE_MTAG_USER,       // tags from here to CUPKEE_MTAG_MAX - 1 are free for application
+
+    CUPKEE_MTAG_MAX = 8     // limited by tag bits of page flags
+};
+
+typedef struct cupkee_memory_tag_t {
+    uint32_t used;          // bytes hold, in block or page size
+    uint32_t quota;         // 0: no limit
+    uint16_t fail;          // allocations refused by quota
+} cupkee_memory_tag_t;
+
 int cupkee_memory_setup(void);
 int cupkee_memory_extend(intptr_t base, size_t size);
 
 int cupkee_free_pages(int order);
+int cupkee_memory_stat(int max, cupkee_memory_stat_t *stat);
+int cupkee_memory_trim(void);
+int cupkee_memory_info(cupkee_memory_info_t *info);
+
+int cupkee_memory_quota_set(int tag, size_t quota);
+int cupkee_memory_tag_info(int tag, cupkee_memory_tag_t *info);
+const char *cupkee_memory_tag_name(int tag);
 
 void *cupkee_page_memory(cupkee_page_t *page);
 cupkee_page_t *cupkee_memory_page(void *ptr);
 
 cupkee_page_t *cupkee_page_alloc(int order);
+cupkee_page_t *cupkee_page_alloc_prefer(int order, int zone);
+cupkee_page_t *cupkee_page_alloc_tagged(int order, int tag);
 void cupkee_page_free(cupkee_page_t *page);
 
 void *cupkee_malloc(size_t s);
+void *cupkee_malloc_tagged(size_t s, int tag);
+void *cupkee_malloc_aligned(size_t s, size_t align);
+void *cupkee_dma_alloc(size_t s);
 void  cupkee_free(void *p);
+void *cupkee_realloc(void *p, size_t s);
 
 #endif /* __CUPKEE_MEMORY_INC__ */
 
@@ -31,6 +31,11 @@ val_t native_pin(env_t *env, int ac, val_t *av);
 val_t native_pin_toggle(env_t *env, int ac, val_t *av);
 val_t native_pin_group(env_t *env, int ac, val_t *av);
 
+/* cupkee_shell_topic.c */
+val_t native_topic_on(env_t *env, int ac, val_t *av);
+val_t native_topic_off(env_t *env, int ac, val_t *av);
+val_t native_topic_emit(env_t *env, int ac, val_t *av);
+
 /* cupkee_shell_sdmp.c */
 val_t native_report(env_t *env, int ac, val_t *av);
 val_t native_interface(env_t *env, int ac, val_t *av);
@@ -24,6 +24,18 @@
 #define CUPKEE_ENTRY_ID(p)      (CUPKEE_OBJECT_PTR(p)->id)
 #define CUPKEE_ID_INVALID       (-1)
 
+/* Object ref: references of native code in low bits, with CUPKEE_FLAG_LANG & KEEP */
+#define CUPKEE_OBJECT_REF_MASK  (0x3F)
+
+/* Object id: generation of slot in high bits, slot of object map in low bits */
+#define CUPKEE_ID_SLOT_BITS     (8)
+#define CUPKEE_ID_SLOT(id)      ((id) & ((1 << CUPKEE_ID_SLOT_BITS) - 1))
+#define CUPKEE_ID_GEN_MASK      (0x7F)
+
+#if CUPKEE_OBJECT_NUM_MAX > (1 << CUPKEE_ID_SLOT_BITS)
+#error "CUPKEE_OBJECT_NUM_MAX out of id range"
+#endif
+
 enum cupkee_object_elem_type {
     CUPKEE_OBJECT_ELEM_NV,
     CUPKEE_OBJECT_ELEM_INT,
@@ -33,9 +45,19 @@ enum cupkee_object_elem_type {
     CUPKEE_OBJECT_ELEM_ENTRY,
 };
 
+/* Property of object, table of them should be sorted by name */
+typedef struct cupkee_prop_t {
+    const char *name;
+    int (*get) (void *entry, intptr_t *p);
+    int (*set) (void *entry, int t, intptr_t v);
+} cupkee_prop_t;
+
 typedef struct cupkee_desc_t {
     const char *name;
 
+    const cupkee_prop_t *props; // Looked up before prop_get & prop_set
+    int                  prop_num;
+
     void (*destroy) (void *entry);
 
     void (*error_handle) (void *entry, int error);
@@ -67,14 +89,27 @@ typedef struct cupkee_object_t {
 
 int  cupkee_object_setup(void);
 void cupkee_object_event_dispatch(uint16_t which, uint8_t code);
-void cupkee_object_gc(void);
+int  cupkee_object_gc(void);
+void cupkee_object_keep(cupkee_object_t *obj);
+void cupkee_object_lang(cupkee_object_t *obj);
+int  cupkee_object_ref(cupkee_object_t *obj);
+void cupkee_object_unref(cupkee_object_t *obj);
 
 static inline int cupkee_is_object(void *entry, uint8_t tag) {
     return entry && (CUPKEE_OBJECT_PTR(entry)->tag == tag);
 };
 
+static inline void cupkee_object_event_post_data(int id, uint8_t code, uint32_t data) {
+    // I/O completion goes before application events
+    uint8_t prio = (code == CUPKEE_EVENT_ERROR || code == CUPKEE_EVENT_RESPONSE ||
+                    code == CUPKEE_EVENT_DATA  || code == CUPKEE_EVENT_DRAIN) ?
+                   EVENT_PRIO_URGENT : EVENT_PRIO_NORMAL;
+
+    cupkee_event_post_ext(prio, EVENT_OBJECT, code, id, data);
+}
+
 static inline void cupkee_object_event_post(int id, uint8_t code) {
-    cupkee_event_post(EVENT_OBJECT, code, id);
+    cupkee_object_event_post_data(id, code, 0);
 }
 
 int  cupkee_object_register(size_t size, const cupkee_desc_t *desc);
@@ -101,7 +136,10 @@ const void *cupkee_object_desc(cupkee_object_t *obj);
 
 int  cupkee_create_id(int tag);
 void *cupkee_id_entry(int id, uint8_t tag);
+int   cupkee_id_tag(int id);
 
+int  cupkee_ref(void *entry);
+void cupkee_unref(void *entry);
 int cupkee_release(void *entry);
 int cupkee_tag(void *entry);
 
@@ -124,5 +162,13 @@ int  cupkee_elem_get(void *entry, int i, intptr_t *p);
 int  cupkee_prop_set(void *entry, const char *k, int t, intptr_t data);
 int  cupkee_prop_get(void *entry, const char *k, intptr_t *p);
 
+/* Same as above, lookup is cached by address of k, for keys mostly interned */
+int  cupkee_prop_set_sym(void *entry, const char *k, int t, intptr_t data);
+int  cupkee_prop_get_sym(void *entry, const char *k, intptr_t *p);
+
+int  cupkee_prop_sorted(const void *table, int num, size_t size);
+int  cupkee_prop_search(const void *table, int num, size_t size, const char *k);
+int  cupkee_prop_search_sym(const void *table, int num, size_t size, const char *k);
+
 #endif /* __CUPKEE_OBJECT_INC__ */
 
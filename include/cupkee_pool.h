@@ -0,0 +1,46 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#ifndef __CUPKEE_POOL_INC__
+#define __CUPKEE_POOL_INC__
+
+/* Pool of fixed size objects
+ *
+ * Free objects are linked by their first word. Storage is given at init,
+ * or taken from cupkee_malloc by chunk of "grow" objects when the pool is
+ * empty. Chunks are never given back, so a pool reaches a steady state
+ * without touching the general allocator.
+ */
+typedef struct cupkee_pool_t {
+    void    *free;
+    uint16_t size;
+    uint16_t grow;
+
+    uint16_t total;     // objects owned by pool
+    uint16_t used;      // objects in use
+    uint16_t peak;      // high-water mark of used
+    uint16_t refill;    // chunks taken from cupkee_malloc
+} cupkee_pool_t;
+
+int   cupkee_pool_init(cupkee_pool_t *pool, size_t size, int grow, void *storage, size_t storage_size);
+void *cupkee_pool_get(cupkee_pool_t *pool);
+void  cupkee_pool_put(cupkee_pool_t *pool, void *obj);
+
+#endif /* __CUPKEE_POOL_INC__ */
+
@@ -20,6 +20,8 @@
 #ifndef __CUPKEE_PROCESS_INC__
 #define __CUPKEE_PROCESS_INC__
 
+void cupkee_process_setup(void);
+
 int cupkee_process_start(void (*fn)(void *entry), intptr_t data, void (*finish)(int err, intptr_t data));
 
 intptr_t cupkee_process_data(void *entry);
@@ -0,0 +1,45 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#ifndef __CUPKEE_PROFILE_INC__
+#define __CUPKEE_PROFILE_INC__
+
+enum cupkee_profile_kind_e {
+    CUPKEE_PROFILE_TYPE = 0,    // indexed by event type
+    CUPKEE_PROFILE_TAG,         // indexed by object tag
+};
+
+/* Log2 histograms of event dispatch, in cycles of hw_cycle_count
+ *
+ * Bucket 0 counts zero, bucket n counts [2^(n-1), 2^n), and the last one
+ * counts everything bigger.
+ */
+typedef struct cupkee_profile_hist_t {
+    uint32_t wait[CUPKEE_EVENT_PROFILE_BUCKETS];    // from post to dispatch
+    uint32_t run[CUPKEE_EVENT_PROFILE_BUCKETS];     // in handler
+} cupkee_profile_hist_t;
+
+void cupkee_profile_reset(void);
+void cupkee_profile_event(const cupkee_event_t *e, int tag, uint32_t wait, uint32_t run);
+
+/* NULL if index out of range, or profile is not built in */
+const cupkee_profile_hist_t *cupkee_profile_hist(int kind, int index);
+
+#endif /* __CUPKEE_PROFILE_INC__ */
+
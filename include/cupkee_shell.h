@@ -24,6 +24,8 @@
 #include <panda.h>
 
 typedef struct cupkee_meta_t {
+    const native_t *methods;    // Sorted by name, looked up before prop_get
+    int             method_num;
     int (*prop_get)(void *entry, const char *key, val_t *res);
 } cupkee_meta_t;
 
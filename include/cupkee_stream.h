@@ -76,6 +76,7 @@ void cupkee_stream_pause(cupkee_stream_t *s);
 void cupkee_stream_shutdown(cupkee_stream_t *s, uint8_t flags);
 
 void cupkee_stream_sync(cupkee_stream_t *s, uint32_t systicks);
+uint32_t cupkee_stream_next(cupkee_stream_t *s, uint32_t systicks);
 int cupkee_stream_push(cupkee_stream_t *s, size_t n, const void *data);
 int cupkee_stream_pull(cupkee_stream_t *s, size_t n, void *data);
 
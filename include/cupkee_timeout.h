@@ -22,27 +22,55 @@
 
 extern volatile uint32_t _cupkee_systicks;
 
+#define CUPKEE_TICKS_INFINITE   (0xFFFFFFFFU)
+
+/* Policy of repeat timeout for periods missed, default is coalesce */
+#define CUPKEE_TIMEOUT_COALESCE (0x00)  // One callback, with count of missed periods
+#define CUPKEE_TIMEOUT_CATCHUP  (0x02)  // One callback for each missed period
+#define CUPKEE_TIMEOUT_SKIP     (0x04)  // One callback, missed periods are dropped silently
+#define CUPKEE_TIMEOUT_POLICY   (CUPKEE_TIMEOUT_CATCHUP | CUPKEE_TIMEOUT_SKIP)
+
+/* Timeout id: generation of slot in high bits, slot in timeout map in low bits */
+#define CUPKEE_TIMEOUT_ID_SHIFT (16)
+#define CUPKEE_TIMEOUT_GEN_MASK (0x7FFF)
+
+#if CUPKEE_TIMEOUT_MAX > (1 << CUPKEE_TIMEOUT_ID_SHIFT)
+#error "CUPKEE_TIMEOUT_MAX out of id range"
+#endif
+
 typedef void (*cupkee_timeout_handle_t)(int drop, void *param);
 typedef struct cupkee_timeout_t {
-    struct cupkee_timeout_t *next;
+    list_head_t node;       // wheel slot
+    list_head_t link;       // list of timers in use
     cupkee_timeout_handle_t handle;
     int      id;
     int      flags;
     uint32_t wait;
-    uint32_t from;
+    uint32_t slack;         // Ticks allowed to be late, to batch with others
+    uint32_t expire;
     void    *param;
 } cupkee_timeout_t;
 
 void cupkee_timeout_setup(void);
 void cupkee_timeout_sync(uint32_t ticks);
+uint32_t cupkee_timeout_next(uint32_t ticks);
+uint32_t cupkee_timeout_missed(void);
 
-cupkee_timeout_t *cupkee_timeout_register(uint32_t wait, int repeat, cupkee_timeout_handle_t handle, void *param);
+cupkee_timeout_t *cupkee_timeout_register_ext(uint32_t wait, uint32_t slack, int flags, cupkee_timeout_handle_t handle, void *param);
 void cupkee_timeout_unregister(cupkee_timeout_t *t);
 
 int cupkee_timeout_clear_all(void);
 int cupkee_timeout_clear_with_flags(uint32_t flags);
 int cupkee_timeout_clear_with_id(uint32_t id);
 
+static inline cupkee_timeout_t *cupkee_timeout_register(uint32_t wait, int flags, cupkee_timeout_handle_t handle, void *param) {
+    return cupkee_timeout_register_ext(wait, 0, flags, handle, param);
+}
+
+static inline uint32_t cupkee_timeout_slot(uint32_t id) {
+    return id & ((1U << CUPKEE_TIMEOUT_ID_SHIFT) - 1);
+}
+
 static inline uint32_t cupkee_systicks(void) {
     return _cupkee_systicks;
 }
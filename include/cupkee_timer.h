@@ -56,10 +56,10 @@ static inline intptr_t cupkee_timer_callback_param(void *entry) {
     return timer->cb_param;
 };
 
-// Should only be call in BSP
+// Should only be call in BSP, payload: systicks of rewind
 static inline void cupkee_timer_rewind(int id)
 {
-    cupkee_object_event_post(id, CUPKEE_EVENT_REWIND);
+    cupkee_object_event_post_data(id, CUPKEE_EVENT_REWIND, _cupkee_systicks);
 }
 
 #endif /* __CUPKEE_TIMER_INC__ */
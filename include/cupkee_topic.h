@@ -0,0 +1,48 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#ifndef __CUPKEE_TOPIC_INC__
+#define __CUPKEE_TOPIC_INC__
+
+/* Publish/subscribe of user topics
+ *
+ * A publish is one EVENT_TOPIC in event queue, whatever the number of
+ * subscribers, and is fanned out to them in one dispatch pass. Handlers
+ * are called as handler(entry, topic, value), and with CUPKEE_TOPIC_DROP
+ * as topic when unsubscribed.
+ */
+#define CUPKEE_TOPIC_DROP   (-1)
+
+void cupkee_topic_setup(void);
+
+int  cupkee_topic_subscribe(int topic, cupkee_callback_t handler, void *entry);
+int  cupkee_topic_unsubscribe(int sid);
+int  cupkee_topic_subscribers(int topic);
+
+void cupkee_topic_dispatch(uint16_t topic, uint32_t value);
+
+static inline int cupkee_topic_publish(int topic, uint32_t value) {
+    if ((unsigned)topic >= CUPKEE_TOPIC_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+    return cupkee_event_post_ext(EVENT_PRIO_NORMAL, EVENT_TOPIC, 0, topic, value) ? CUPKEE_OK : -CUPKEE_EOVERFLOW;
+}
+
+#endif /* __CUPKEE_TOPIC_INC__ */
+
@@ -21,3 +21,9 @@ ARCH = pc
 MCU  = x86
 
 BOARD_SRC_DIR = test
+
+DEFS += -DCUPKEE_EVENT_PROFILE=1
+# Host benchmarks, not run by default: make test BENCH=1
+ifeq (${BENCH},1)
+DEFS += -DCUPKEE_TEST_BENCH=1 -DCUPKEE_TIMEOUT_MAX=10240
+endif
@@ -23,24 +23,88 @@
 
 static const uint8_t *cupkee_board_id = NULL;
 
+static void event_dispatch(cupkee_event_t *e)
+{
+#if CUPKEE_EVENT_PROFILE
+    uint32_t start = hw_cycle_count();
+    // Get tag first, object may be destroyed by its event
+    int tag = e->type == EVENT_OBJECT ? cupkee_id_tag(e->which) : CUPKEE_ID_INVALID;
+#endif
+
+    if (e->type == EVENT_SYSTICK) {
+        cupkee_device_sync(_cupkee_systicks);
+        cupkee_timeout_sync(_cupkee_systicks);
+    } else
+    if (e->type == EVENT_OBJECT) {
+        cupkee_object_event_dispatch(e->which, e->code);
+    } else
+    if (e->type == EVENT_PIN) {
+        cupkee_pin_event_dispatch(e->which, e->code);
+    } else
+    if (e->type == EVENT_TOPIC) {
+        cupkee_topic_dispatch(e->which, e->data);
+    }
+
+#if CUPKEE_EVENT_PROFILE
+    cupkee_profile_event(e, tag, start - e->stamp, hw_cycle_count() - start);
+#endif
+}
+
+/* All urgent events are handled, but at most CUPKEE_DEFER_BUDGET deferred
+ * works and CUPKEE_EVENT_NORMAL_BUDGET normal events, and urgent queue is
+ * checked again before each of them.
+ */
 void cupkee_event_poll(void)
 {
     cupkee_event_t e;
+    int defer_budget = CUPKEE_DEFER_BUDGET;
+    int budget = CUPKEE_EVENT_NORMAL_BUDGET;
 
-    while (cupkee_event_take(&e)) {
-        if (e.type == EVENT_SYSTICK) {
-            cupkee_device_sync(_cupkee_systicks);
-            cupkee_timeout_sync(_cupkee_systicks);
+    while (1) {
+        if (cupkee_event_take_prio(EVENT_PRIO_URGENT, &e)) {
+            event_dispatch(&e);
         } else
-        if (e.type == EVENT_OBJECT) {
-            cupkee_object_event_dispatch(e.which, e.code);
+        if (defer_budget > 0 && cupkee_defer_run(1)) {
+            defer_budget--;
         } else
-        if (e.type == EVENT_PIN) {
-            cupkee_pin_event_dispatch(e.which, e.code);
+        if (budget > 0 && cupkee_event_take_prio(EVENT_PRIO_NORMAL, &e)) {
+            event_dispatch(&e);
+            budget--;
+        } else {
+            break;
         }
     }
 }
 
+/* Sleep until next deadline of timeouts and devices, or any interrupt.
+ * Event queue is checked with interrupts masked, so a post from ISR
+ * just before sleep is not missed.
+ */
+void cupkee_idle(void)
+{
+    uint32_t now = _cupkee_systicks;
+    uint32_t ticks, dev_ticks;
+    uint32_t state;
+
+    ticks = cupkee_timeout_next(now);
+    dev_ticks = cupkee_device_next(now);
+    if (ticks > dev_ticks) {
+        ticks = dev_ticks;
+    }
+    if (ticks > CUPKEE_IDLE_TICKS_MAX) {
+        ticks = CUPKEE_IDLE_TICKS_MAX;
+    }
+    if (ticks == 0) {
+        return;
+    }
+
+    hw_enter_critical(&state);
+    if (!cupkee_event_pending() && !cupkee_defer_pending()) {
+        hw_idle(ticks);
+    }
+    hw_exit_critical(state);
+}
+
 void cupkee_sysinfo_get(uint8_t *info_buf)
 {
     // cupkee version info
@@ -80,12 +144,18 @@ void cupkee_init(const uint8_t *id)
 
     cupkee_timeout_setup();
 
+    cupkee_process_setup();
+
     cupkee_timer_setup();
 
     cupkee_event_setup();
+    cupkee_defer_setup();
+    cupkee_profile_reset();
 
     cupkee_pin_setup();
 
+    cupkee_topic_setup();
+
     cupkee_device_setup();
 
     cupkee_sysdisk_init();
@@ -107,6 +177,8 @@ void cupkee_loop(void)
         cupkee_device_poll();
 
         cupkee_event_poll();
+
+        cupkee_idle();
     }
 }
 
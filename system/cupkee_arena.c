@@ -0,0 +1,103 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee.h"
+
+#define ARENA_ALIGN     sizeof(intptr_t)
+
+static inline cupkee_page_t *arena_chunk_last(cupkee_arena_t *arena)
+{
+    return list_is_empty(&arena->chunks) ? NULL : (cupkee_page_t *)arena->chunks.prev;
+}
+
+static inline size_t arena_chunk_size(cupkee_page_t *chunk)
+{
+    return CUPKEE_PAGE_SIZE << chunk->order;
+}
+
+void cupkee_arena_init(cupkee_arena_t *arena, int order, int tag)
+{
+    list_head_init(&arena->chunks);
+    arena->off   = 0;
+    arena->order = order < CUPKEE_PAGE_ORDERR_MAX ? order : CUPKEE_PAGE_ORDERR_MAX - 1;
+    arena->tag   = tag;
+}
+
+void *cupkee_arena_alloc(cupkee_arena_t *arena, size_t size)
+{
+    cupkee_page_t *chunk = arena_chunk_last(arena);
+    uint8_t *mem;
+
+    size = CUPKEE_SIZE_ALIGN(size, ARENA_ALIGN);
+    if (!size) {
+        return NULL;
+    }
+
+    if (!chunk || arena->off + size > arena_chunk_size(chunk)) {
+        int order = arena->order;
+
+        while (size > (CUPKEE_PAGE_SIZE << order)) {
+            if (++order >= CUPKEE_PAGE_ORDERR_MAX) {
+                return NULL;
+            }
+        }
+
+        if (NULL == (chunk = cupkee_page_alloc_tagged(order, arena->tag))) {
+            return NULL;
+        }
+        // Page list is free, while it is in used
+        list_add_tail(&chunk->list, &arena->chunks);
+        arena->off = 0;
+    }
+
+    mem = (uint8_t *)cupkee_page_memory(chunk) + arena->off;
+    arena->off += size;
+
+    return mem;
+}
+
+void cupkee_arena_mark(cupkee_arena_t *arena, cupkee_arena_mark_t *mark)
+{
+    mark->chunk = arena_chunk_last(arena);
+    mark->off   = arena->off;
+}
+
+void cupkee_arena_reset_to(cupkee_arena_t *arena, const cupkee_arena_mark_t *mark)
+{
+    cupkee_page_t *chunk;
+
+    while (NULL != (chunk = arena_chunk_last(arena)) && chunk != mark->chunk) {
+        list_del(&chunk->list);
+        cupkee_page_free(chunk);
+    }
+
+    arena->off = chunk ? mark->off : 0;
+}
+
+void cupkee_arena_reset(cupkee_arena_t *arena)
+{
+    cupkee_page_t *chunk;
+
+    while (NULL != (chunk = arena_chunk_last(arena))) {
+        list_del(&chunk->list);
+        cupkee_page_free(chunk);
+    }
+    arena->off = 0;
+}
+
@@ -71,12 +71,21 @@ int cupkee_buffer_xxx(cupkee_buffer_t *b, void **pptr)
 }
 
 int cupkee_buffer_space_to(cupkee_buffer_t *b, size_t n) {
+    return cupkee_buffer_space_to_tagged(b, n, CUPKEE_MTAG_NONE);
+}
+
+int cupkee_buffer_space_to_tagged(cupkee_buffer_t *b, size_t n, int tag) {
     if (n > b->cap) {
-        void *ptr= cupkee_malloc(n);
+        void *ptr;
+
+        // Owned memory keeps its tag on realloc
+        if (b->ptr && (b->flags & CUPKEE_FLAG_OWNED)) {
+            ptr = cupkee_realloc(b->ptr, n);
+        } else {
+            ptr = cupkee_malloc_tagged(n, tag);
+        }
+
         if (ptr) {
-            if (b->ptr && (b->flags & CUPKEE_FLAG_OWNED)) {
-                cupkee_free(b->ptr);
-            }
             b->flags |= CUPKEE_FLAG_OWNED;
             b->ptr = ptr;
             b->cap = n;
@@ -17,6 +17,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  **/
 
+#include <stdlib.h>
 #include <cupkee.h>
 
 #define COMMAND_ARG_MAX      8
@@ -82,6 +83,103 @@ static int command_complete(void)
     return CON_EXECUTE_DEF;
 }
 
+/* Memory used by each allocation tag
+ *   usage: <name> [tag quota]
+ */
+int cupkee_command_memory(int ac, char **av)
+{
+    int tag;
+
+    if (ac == 3) {
+        for (tag = 0; tag < CUPKEE_MTAG_MAX; tag++) {
+            if (!strcmp(av[1], cupkee_memory_tag_name(tag))) {
+                return cupkee_memory_quota_set(tag, strtoul(av[2], NULL, 0));
+            }
+        }
+        return -CUPKEE_EINVAL;
+    }
+
+    for (tag = 0; tag < CUPKEE_MTAG_MAX; tag++) {
+        cupkee_memory_tag_t info;
+
+        cupkee_memory_tag_info(tag, &info);
+        if (info.used || info.quota || info.fail) {
+            console_log_sync("%s: %u/%u, fail: %u\r\n", cupkee_memory_tag_name(tag),
+                             (unsigned)info.used, (unsigned)info.quota, (unsigned)info.fail);
+        }
+    }
+
+    return 0;
+}
+
+static void command_profile_buckets(const char *name, int index, const char *what, const uint32_t *b)
+{
+    int i;
+
+    console_log_sync("%s%d %s:", name, index, what);
+    for (i = 0; i < CUPKEE_EVENT_PROFILE_BUCKETS; i++) {
+        if (!b[i]) {
+            continue;
+        }
+        if (i < CUPKEE_EVENT_PROFILE_BUCKETS - 1) {
+            console_log_sync(" %u<%u", (unsigned)b[i], 1U << i);
+        } else {
+            console_log_sync(" %u>=%u", (unsigned)b[i], 1U << (i - 1));
+        }
+    }
+    console_log_sync("\r\n");
+}
+
+static void command_profile_show(const char *name, int index, const cupkee_profile_hist_t *h)
+{
+    command_profile_buckets(name, index, "wait", h->wait);
+    command_profile_buckets(name, index, "run", h->run);
+}
+
+static int command_profile_used(const cupkee_profile_hist_t *h)
+{
+    int i;
+
+    for (i = 0; i < CUPKEE_EVENT_PROFILE_BUCKETS; i++) {
+        if (h->run[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Event dispatch histograms in cycles, by event type and object tag
+ *   output: count<bound of each log2 bucket
+ *   usage: <name> [reset]
+ */
+int cupkee_command_profile(int ac, char **av)
+{
+    const cupkee_profile_hist_t *h;
+    int i;
+
+    if (!cupkee_profile_hist(CUPKEE_PROFILE_TYPE, 0)) {
+        return -CUPKEE_EIMPLEMENT;
+    }
+
+    if (ac == 2 && !strcmp(av[1], "reset")) {
+        cupkee_profile_reset();
+        return 0;
+    }
+
+    for (i = 0; (h = cupkee_profile_hist(CUPKEE_PROFILE_TYPE, i)) != NULL; i++) {
+        if (command_profile_used(h)) {
+            command_profile_show("type", i, h);
+        }
+    }
+    for (i = 0; (h = cupkee_profile_hist(CUPKEE_PROFILE_TAG, i)) != NULL; i++) {
+        if (command_profile_used(h)) {
+            command_profile_show("tag", i, h);
+        }
+    }
+
+    return 0;
+}
+
 int cupkee_command_init(int n, cupkee_command_entry_t *entrys, int buf_size, char *buf)
 {
     command_buf = buf;
@@ -0,0 +1,152 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee.h"
+
+/* Same lock-free ring as event queue: producers claim a cell by CAS on head,
+ * and publish it by cell sequence. Only main loop runs the works.
+ */
+#if CUPKEE_DEFER_SIZE & (CUPKEE_DEFER_SIZE - 1)
+#error "CUPKEE_DEFER_SIZE should be power of 2"
+#endif
+
+#define DEFER_MASK  (CUPKEE_DEFER_SIZE - 1)
+
+typedef struct defer_cell_t {
+    uint32_t          seq;
+    cupkee_defer_fn_t fn;
+    void             *arg;
+} defer_cell_t;
+
+static defer_cell_t defer_cells[CUPKEE_DEFER_SIZE];
+static uint32_t defer_head;
+static uint32_t defer_tail;
+
+static uint32_t defer_depth_max;
+static uint32_t defer_drops;
+static uint32_t defer_runs;
+
+static void defer_depth_update(uint32_t depth)
+{
+    uint32_t max = __atomic_load_n(&defer_depth_max, __ATOMIC_RELAXED);
+
+    while (depth > max) {
+        if (__atomic_compare_exchange_n(&defer_depth_max, &max, depth, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+void cupkee_defer_setup(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < CUPKEE_DEFER_SIZE; i++) {
+        __atomic_store_n(&defer_cells[i].seq, i, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&defer_tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&defer_head, 0, __ATOMIC_RELEASE);
+
+    defer_depth_max = 0;
+    defer_drops = 0;
+    defer_runs = 0;
+}
+
+int cupkee_defer(cupkee_defer_fn_t fn, void *arg)
+{
+    uint32_t pos = __atomic_load_n(&defer_head, __ATOMIC_RELAXED);
+    defer_cell_t *cell;
+
+    if (!fn) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (;;) {
+        int32_t diff;
+
+        cell = &defer_cells[pos & DEFER_MASK];
+        diff = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&defer_head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else
+        if (diff < 0) {
+            __atomic_fetch_add(&defer_drops, 1, __ATOMIC_RELAXED);
+            return -CUPKEE_EOVERFLOW;
+        } else {
+            pos = __atomic_load_n(&defer_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->fn  = fn;
+    cell->arg = arg;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    defer_depth_update(pos + 1 - __atomic_load_n(&defer_tail, __ATOMIC_RELAXED));
+
+    return CUPKEE_OK;
+}
+
+/* Run at most budget works, return the number of works run */
+int cupkee_defer_run(int budget)
+{
+    int n = 0;
+
+    while (n < budget) {
+        uint32_t pos = defer_tail;
+        defer_cell_t *cell = &defer_cells[pos & DEFER_MASK];
+        cupkee_defer_fn_t fn;
+        void *arg;
+
+        if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+            break;
+        }
+
+        fn  = cell->fn;
+        arg = cell->arg;
+        __atomic_store_n(&cell->seq, pos + CUPKEE_DEFER_SIZE, __ATOMIC_RELEASE);
+        __atomic_store_n(&defer_tail, pos + 1, __ATOMIC_RELAXED);
+
+        // Cell is given back first, work could defer itself again
+        fn(arg);
+        n++;
+    }
+    defer_runs += n;
+
+    return n;
+}
+
+int cupkee_defer_pending(void)
+{
+    uint32_t pos = defer_tail;
+
+    return __atomic_load_n(&defer_cells[pos & DEFER_MASK].seq, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+void cupkee_defer_stat(cupkee_defer_stat_t *stat)
+{
+    stat->depth_max = __atomic_load_n(&defer_depth_max, __ATOMIC_RELAXED);
+    stat->drops     = __atomic_load_n(&defer_drops, __ATOMIC_RELAXED);
+    stat->runs      = defer_runs;
+}
+
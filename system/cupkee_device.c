@@ -26,6 +26,7 @@ static uint8_t device_type_num = 0;
 
 static cupkee_device_desc_t const *device_descs[CUPKEE_DEVICE_TYPE_MAX];
 static cupkee_device_t      *device_work = NULL;
+static cupkee_pool_t         device_stream_pool;
 
 static inline cupkee_device_t *device_entry_by_id(int id)
 {
@@ -91,7 +92,7 @@ static void device_reset(cupkee_device_t *dev)
 
     if (dev->s) {
         cupkee_stream_deinit(dev->s);
-        cupkee_free(dev->s);
+        cupkee_pool_put(&device_stream_pool, dev->s);
         dev->s = NULL;
     }
 }
@@ -131,6 +132,7 @@ static cupkee_device_t *device_request(int type, int instance)
 
     cupkee_buffer_init(&dev->req_buf, 0, NULL, 0);
     cupkee_buffer_init(&dev->res_buf, 0, NULL, 0);
+    cupkee_arena_init(&dev->req_arena, 0, CUPKEE_MTAG_DEVICE);
 
     return dev;
 }
@@ -150,6 +152,7 @@ static void device_destroy(void *entry)
 
     cupkee_buffer_deinit(&dev->req_buf);
     cupkee_buffer_deinit(&dev->res_buf);
+    cupkee_arena_reset(&dev->req_arena);
 }
 
 static int device_read(cupkee_stream_t *s, size_t n, void *buf)
@@ -200,10 +203,10 @@ static void device_stream_init(cupkee_device_t *dev, int id)
         tx_size = 0;
     }
 
-    s = cupkee_malloc(sizeof(cupkee_stream_t));
+    s = cupkee_pool_get(&device_stream_pool);
     if (s) {
         if (0 != cupkee_stream_init(s, id, rx_size, tx_size, device_read, device_write)) {
-            cupkee_free(s);
+            cupkee_pool_put(&device_stream_pool, s);
         } else {
             dev->s = s;
         }
@@ -218,7 +221,7 @@ static int device_query_start(cupkee_device_t *dev, int want, cupkee_callback_t
         return -CUPKEE_EBUSY;
     }
 
-    if (want > 0 && (cupkee_buffer_space_to(&dev->res_buf, want) < want)) {
+    if (want > 0 && (cupkee_buffer_space_to_tagged(&dev->res_buf, want, CUPKEE_MTAG_DEVICE) < want)) {
         return -CUPKEE_ENOMEM;
     }
 
@@ -254,6 +257,7 @@ static void device_event_handle(void *entry, uint8_t event)
         }
         if (event == CUPKEE_EVENT_RESPONSE) {
             cupkee_buffer_deinit(&dev->req_buf);
+            cupkee_arena_reset(&dev->req_arena);
             dev->flags &= ~DEVICE_FL_BUSY;
         }
     }
@@ -336,23 +340,23 @@ static int device_conf_set(cupkee_device_t *dev, const char *k, int t, intptr_t
     return retval;
 }
 
-static int device_prop_get(void *entry, const char *key, intptr_t *p)
+static int device_is_enabled_get(void *entry, intptr_t *p)
 {
-    int retval;
-
     if (!is_device(entry)) {
         return -CUPKEE_EINVAL;
     }
 
-    retval = device_conf_get(entry, key, p);
-    if (retval <= CUPKEE_OBJECT_ELEM_NV) {
-        if (!strcmp("isEnabled", key)) {
-            *p = device_is_enabled(entry);
-            retval = CUPKEE_OBJECT_ELEM_BOOL;
-        }
+    *p = device_is_enabled(entry);
+    return CUPKEE_OBJECT_ELEM_BOOL;
+}
+
+static int device_prop_get(void *entry, const char *key, intptr_t *p)
+{
+    if (!is_device(entry)) {
+        return -CUPKEE_EINVAL;
     }
 
-    return retval;
+    return device_conf_get(entry, key, p);
 }
 
 static int device_prop_set(void *entry, const char *k, int t, intptr_t v)
@@ -403,9 +407,17 @@ static int device_elem_set(void *entry, int i, int t, intptr_t v)
     }
 }
 
+// Sorted by name
+static const cupkee_prop_t device_props[] = {
+    {"isEnabled", device_is_enabled_get, NULL},
+};
+
 static const cupkee_desc_t device_desc = {
     .name         = "Device",
 
+    .props        = device_props,
+    .prop_num     = sizeof(device_props) / sizeof(cupkee_prop_t),
+
     .error_handle = device_error_handle,
     .event_handle = device_event_handle,
     .streaming    = device_stream,
@@ -432,6 +444,8 @@ int cupkee_device_setup(void)
     device_work = NULL;
     device_type_num = 0;
 
+    cupkee_pool_init(&device_stream_pool, sizeof(cupkee_stream_t), CUPKEE_STREAM_POOL_GROW, NULL, 0);
+
     return 0;
 }
 
@@ -485,6 +499,28 @@ void cupkee_device_poll(void)
     }
 }
 
+/* Ticks the devices could wait without poll or sync, 0 if busy polling needed */
+uint32_t cupkee_device_next(uint32_t systicks)
+{
+    cupkee_device_t *dev = device_work;
+    uint32_t next = CUPKEE_TICKS_INFINITE;
+
+    while (dev) {
+        if (dev->driver->poll) {
+            return 0;
+        }
+        if (dev->s) {
+            uint32_t n = cupkee_stream_next(dev->s, systicks);
+            if (n < next) {
+                next = n;
+            }
+        }
+        dev = dev->next;
+    }
+
+    return next;
+}
+
 void *cupkee_device_request(const char *name, int instance)
 {
     int type = device_type(name);
@@ -718,17 +754,22 @@ int cupkee_device_query(void *entry, size_t req_len, void *req_data, int want, c
         return -CUPKEE_EIMPLEMENT;
     }
 
+    if (dev->flags & DEVICE_FL_BUSY) {
+        return -CUPKEE_EBUSY;
+    }
+
     if (req_len) {
-        if (!(buf = cupkee_malloc(req_len))) {
+        if (!(buf = cupkee_arena_alloc(&dev->req_arena, req_len))) {
             return -CUPKEE_ENOMEM;
         }
         memcpy(buf, req_data, req_len);
-        cupkee_buffer_init(&dev->req_buf, req_len, buf, CUPKEE_FLAG_OWNED);
+        cupkee_buffer_init(&dev->req_buf, req_len, buf, 0);
     }
 
     err = device_query_start(dev, want, cb, param);
     if (err < 0) {
         cupkee_buffer_deinit(&dev->req_buf);
+        cupkee_arena_reset(&dev->req_arena);
     }
 
     return err;
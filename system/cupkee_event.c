@@ -18,59 +18,272 @@
  **/
 
 #include "cupkee.h"
-#include "rbuff.h"
 
-#define EVENTQ_SIZE         16
+/* Multi-producer, single-consumer rings without interrupt masking, one per priority
+ *
+ * Each cell carries a sequence number: it equals the position when the
+ * cell is free for producer of that position, and position + 1 when the
+ * event in it is ready for consumer. Producers (ISRs and main loop) claim
+ * a position by compare-and-swap on head; the main loop only takes.
+ */
 #define EMITTER_CODE_MAX    65535
 
-static rbuff_t eventq;
-static cupkee_event_t eventq_mem[EVENTQ_SIZE];
+#if CUPKEE_EVENTQ_SIZE & (CUPKEE_EVENTQ_SIZE - 1)
+#error "CUPKEE_EVENTQ_SIZE should be power of 2"
+#endif
+#if CUPKEE_EVENTQ_URGENT_SIZE & (CUPKEE_EVENTQ_URGENT_SIZE - 1)
+#error "CUPKEE_EVENTQ_URGENT_SIZE should be power of 2"
+#endif
+
+typedef struct eventq_cell_t {
+    uint32_t       seq;
+    cupkee_event_t event;
+} eventq_cell_t;
+
+typedef struct eventq_t {
+    eventq_cell_t *cells;
+    uint32_t       size;
+    uint32_t       head;    // next position to post
+    uint32_t       tail;    // next position to take
+} eventq_t;
+
+static eventq_cell_t urgent_cells[CUPKEE_EVENTQ_URGENT_SIZE];
+static eventq_cell_t normal_cells[CUPKEE_EVENTQ_SIZE];
+
+static eventq_t eventqs[EVENT_PRIO_MAX] = {
+    { urgent_cells, CUPKEE_EVENTQ_URGENT_SIZE, 0, 0 },
+    { normal_cells, CUPKEE_EVENTQ_SIZE, 0, 0 },
+};
+
+static uint32_t eventq_drops[EVENT_TYPE_MAX];
+static uint32_t event_data_curr;
+
+/* Queued counts of coalescable events: increased by post after its push
+ * succeed, decreased by take. A event is not queued again while its count
+ * is positive, and only then: a poster never reports success for a push
+ * still in flight, that may yet fail on a full queue.
+ *
+ * Racing posters may both push, the duplicate is harmless. A take may
+ * decrease the count before the poster increase it, so it can dip below
+ * zero for a moment.
+ *
+ * Payloads of coalescable events are levels (systicks, bytes buffered,
+ * space to write), every post store its own and take deliver the latest.
+ */
+static int8_t queued_systick;
+static int8_t queued_data[CUPKEE_EVENT_COALESCE_IDS];
+static int8_t queued_drain[CUPKEE_EVENT_COALESCE_IDS];
+
+static uint32_t latest_systick;
+static uint32_t latest_data[CUPKEE_EVENT_COALESCE_IDS];
+static uint32_t latest_drain[CUPKEE_EVENT_COALESCE_IDS];
+
+static int8_t *event_queued(uint8_t type, uint8_t code, uint16_t which, uint32_t **latest)
+{
+    if (type == EVENT_SYSTICK) {
+        *latest = &latest_systick;
+        return &queued_systick;
+    }
+
+    // Object id carry a generation above its slot
+    if (type == EVENT_OBJECT && CUPKEE_ID_SLOT(which) < CUPKEE_EVENT_COALESCE_IDS) {
+        uint16_t slot = CUPKEE_ID_SLOT(which);
+
+        if (code == CUPKEE_EVENT_DATA) {
+            *latest = &latest_data[slot];
+            return &queued_data[slot];
+        } else
+        if (code == CUPKEE_EVENT_DRAIN) {
+            *latest = &latest_drain[slot];
+            return &queued_drain[slot];
+        }
+    }
+
+    return NULL;
+}
+
+static int eventq_push(eventq_t *q, uint8_t type, uint8_t code, uint16_t which, uint32_t data)
+{
+    uint32_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    eventq_cell_t *cell;
+
+    for (;;) {
+        int32_t diff;
+
+        cell = &q->cells[pos & (q->size - 1)];
+        diff = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            // pos is reloaded by failed CAS
+        } else
+        if (diff < 0) {
+            // Cell is not taken yet: queue is full
+            return 0;
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->event.type  = type;
+    cell->event.code  = code;
+    cell->event.which = which;
+    cell->event.data  = data;
+#if CUPKEE_EVENT_PROFILE
+    cell->event.stamp = hw_cycle_count();
+#endif
+
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+static int eventq_shift(eventq_t *q, cupkee_event_t *e)
+{
+    uint32_t pos = q->tail;
+    eventq_cell_t *cell = &q->cells[pos & (q->size - 1)];
+
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+        return 0;
+    }
+
+    *e = cell->event;
+
+    __atomic_store_n(&cell->seq, pos + q->size, __ATOMIC_RELEASE);
+    q->tail = pos + 1;
+
+    return 1;
+}
+
+static inline int eventq_is_empty(eventq_t *q)
+{
+    uint32_t pos = q->tail;
+
+    return __atomic_load_n(&q->cells[pos & (q->size - 1)].seq, __ATOMIC_ACQUIRE) != pos + 1;
+}
+
+static void eventq_reset(eventq_t *q)
+{
+    uint32_t i;
+
+    for (i = 0; i < q->size; i++) {
+        __atomic_store_n(&q->cells[i].seq, i, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&q->tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->head, 0, __ATOMIC_RELEASE);
+}
 
 void cupkee_event_setup(void)
 {
-    rbuff_init(&eventq, EVENTQ_SIZE);
+    cupkee_event_reset();
 }
 
 void cupkee_event_reset(void)
 {
-    rbuff_reset(&eventq);
+    int prio;
+
+    for (prio = 0; prio < EVENT_PRIO_MAX; prio++) {
+        eventq_reset(&eventqs[prio]);
+    }
+
+    queued_systick = 0;
+    memset(queued_data, 0, sizeof(queued_data));
+    memset(queued_drain, 0, sizeof(queued_drain));
+    latest_systick = 0;
+    memset(latest_data, 0, sizeof(latest_data));
+    memset(latest_drain, 0, sizeof(latest_drain));
+    memset(eventq_drops, 0, sizeof(eventq_drops));
+    event_data_curr = 0;
 }
 
-int cupkee_event_post(uint8_t type, uint8_t code, uint16_t which)
+int cupkee_event_post_ext(uint8_t prio, uint8_t type, uint8_t code, uint16_t which, uint32_t data)
 {
-    uint32_t state;
-    int pos;
+    uint32_t *latest;
+    int8_t *queued;
 
-    hw_enter_critical(&state);
-    pos = rbuff_push(&eventq);
-    hw_exit_critical(state);
+    if (prio >= EVENT_PRIO_MAX) {
+        prio = EVENT_PRIO_NORMAL;
+    }
 
-    if (pos < 0) {
+    queued = event_queued(type, code, which, &latest);
+
+    if (queued) {
+        // Store before the count is read: a take that follow read it back
+        __atomic_store_n(latest, data, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(queued, __ATOMIC_SEQ_CST) > 0) {
+            // Same event is still in queue
+            return 1;
+        }
+    }
+
+    if (eventq_push(&eventqs[prio], type, code, which, data)) {
+        if (queued) {
+            __atomic_fetch_add(queued, 1, __ATOMIC_RELEASE);
+        }
+        return 1;
+    }
+
+    if (type < EVENT_TYPE_MAX) {
+        __atomic_fetch_add(&eventq_drops[type], 1, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+int cupkee_event_take_prio(uint8_t prio, cupkee_event_t *e)
+{
+    uint32_t *latest;
+    int8_t *queued;
+
+    if (prio >= EVENT_PRIO_MAX || !eventq_shift(&eventqs[prio], e)) {
         return 0;
     }
 
-    eventq_mem[pos].type  = type;
-    eventq_mem[pos].code  = code;
-    eventq_mem[pos].which = which;
+    // Post after here is a new event to handle
+    queued = event_queued(e->type, e->code, e->which, &latest);
+    if (queued) {
+        __atomic_fetch_sub(queued, 1, __ATOMIC_SEQ_CST);
+        e->data = __atomic_load_n(latest, __ATOMIC_SEQ_CST);
+    }
+    event_data_curr = e->data;
 
     return 1;
 }
 
 int cupkee_event_take(cupkee_event_t *e)
 {
-    uint32_t state;
-    int pos;
+    int prio;
+
+    for (prio = 0; prio < EVENT_PRIO_MAX; prio++) {
+        if (cupkee_event_take_prio(prio, e)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    hw_enter_critical(&state);
-    pos = rbuff_shift(&eventq);
-    hw_exit_critical(state);
+int cupkee_event_pending(void)
+{
+    int prio;
 
-    if (pos < 0) {
-        return 0;
+    for (prio = 0; prio < EVENT_PRIO_MAX; prio++) {
+        if (!eventq_is_empty(&eventqs[prio])) {
+            return 1;
+        }
     }
+    return 0;
+}
 
-    *e = eventq_mem[pos];
+uint32_t cupkee_event_data(void)
+{
+    return event_data_curr;
+}
 
-    return 1;
+uint32_t cupkee_event_drops(uint8_t type)
+{
+    return type < EVENT_TYPE_MAX ? __atomic_load_n(&eventq_drops[type], __ATOMIC_RELAXED) : 0;
 }
 
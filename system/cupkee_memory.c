@@ -25,7 +25,7 @@
  * | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
  * +---+---+---+---+---+---+---+---+
  *   \   \   \   \   \   \   \___\____ ZONE_ID
- *    \   \   \   \___\___\___________ Reserved
+ *    \   \   \   \___\___\___________ Allocation tag
  *     \   \   \______________________ Page is in MBCQ
  *      \   \_________________________ Page is in used
  *       \____________________________ Page is head of pages
@@ -33,18 +33,66 @@
 #define PAGE_HEAD       (0x80)
 #define PAGE_INUSED     (0x40)
 #define PAGE_MBCQ       (0x20)
+#define PAGE_TAG_MASK   (0x1C)
+#define PAGE_TAG_SHIFT  (2)
 #define PAGE_ZONE_MASK  (0x03)
 
+#define PAGE_TAG(page)  (((page)->flags & PAGE_TAG_MASK) >> PAGE_TAG_SHIFT)
+
 /* Memory Block Cache queue */
-#define CUPKEE_MBCQ_MAX    (4)
+#define CUPKEE_MBCQ_MAX    (sizeof(mbcq_block_size) / sizeof(mbcq_block_size[0]))
 
 #define MBLOCK_MAGIC    (0xF1)
-#define MBLOCK_SIZE(b)  (CUPKEE_MUNIT_SIZE << (b))
+#define MBLOCK_SIZE(b)  (mbcq_block_size[b])
+#define MBLOCK_NUM(b)   (CUPKEE_PAGE_SIZE / MBLOCK_SIZE(b))
+#define MBLOCK_MAX      MBLOCK_SIZE(CUPKEE_MBCQ_MAX - 1)
+
+/* Size to class lookup, indexed by size in CUPKEE_MUNIT_SIZE units, and
+ * built by preprocessor: class of n units is the count of block sizes
+ * smaller than it, CUPKEE_MBLOCK_SIZES is padded up to 16 classes.
+ */
+#define MBCQ_INDEX_BITS (CUPKEE_PAGE_SHIFT - CUPKEE_MUNIT_SHIFT)
+
+#define MBCQ_PAD        0xFFFF
+#define MBCQ_LT(n, s)   ((s) < ((n) << CUPKEE_MUNIT_SHIFT))
+#define MBCQ_CLASS_(n, s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11, s12, s13, s14, s15, ...) \
+    (MBCQ_LT(n, s0)  + MBCQ_LT(n, s1)  + MBCQ_LT(n, s2)  + MBCQ_LT(n, s3)  + \
+     MBCQ_LT(n, s4)  + MBCQ_LT(n, s5)  + MBCQ_LT(n, s6)  + MBCQ_LT(n, s7)  + \
+     MBCQ_LT(n, s8)  + MBCQ_LT(n, s9)  + MBCQ_LT(n, s10) + MBCQ_LT(n, s11) + \
+     MBCQ_LT(n, s12) + MBCQ_LT(n, s13) + MBCQ_LT(n, s14) + MBCQ_LT(n, s15))
+#define MBCQ_CLASS_X(n, ...)    MBCQ_CLASS_(n, __VA_ARGS__)
+#define MBCQ_CLASS(n)   MBCQ_CLASS_X(n, CUPKEE_MBLOCK_SIZES, \
+                                     MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, \
+                                     MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD, MBCQ_PAD)
+
+#define MBCQ_I1(n)      MBCQ_CLASS(n)
+#define MBCQ_I2(n)      MBCQ_I1(n),  MBCQ_I1((n) + 1)
+#define MBCQ_I4(n)      MBCQ_I2(n),  MBCQ_I2((n) + 2)
+#define MBCQ_I8(n)      MBCQ_I4(n),  MBCQ_I4((n) + 4)
+#define MBCQ_I16(n)     MBCQ_I8(n),  MBCQ_I8((n) + 8)
+#define MBCQ_I32(n)     MBCQ_I16(n), MBCQ_I16((n) + 16)
+#define MBCQ_I64(n)     MBCQ_I32(n), MBCQ_I32((n) + 32)
+#define MBCQ_I128(n)    MBCQ_I64(n), MBCQ_I64((n) + 64)
+#define MBCQ_I256(n)    MBCQ_I128(n), MBCQ_I128((n) + 128)
+
+// One entry for each unit of a page, and the page size itself
+#if   MBCQ_INDEX_BITS == 5
+#define MBCQ_INDEX      MBCQ_I32(0), MBCQ_I1(32)
+#elif MBCQ_INDEX_BITS == 6
+#define MBCQ_INDEX      MBCQ_I64(0), MBCQ_I1(64)
+#elif MBCQ_INDEX_BITS == 7
+#define MBCQ_INDEX      MBCQ_I128(0), MBCQ_I1(128)
+#elif MBCQ_INDEX_BITS == 8
+#define MBCQ_INDEX      MBCQ_I256(0), MBCQ_I1(256)
+#else
+#error "CUPKEE_PAGE_SIZE should be 32 to 256 CUPKEE_MUNIT_SIZE"
+#endif
 
 typedef struct cupkee_zone_t {
     intptr_t base;
     uint32_t page_num;
     list_head_t   pages_free[CUPKEE_PAGE_ORDERR_MAX];
+    uint16_t      pages_free_num[CUPKEE_PAGE_ORDERR_MAX];
     cupkee_page_t pages[0];
 } cupkee_zone_t;
 
@@ -53,30 +101,114 @@ typedef struct mblock_head_t {
     intptr_t comp;
 } mblock_head_t;
 
+static const uint16_t mbcq_block_size[] = { CUPKEE_MBLOCK_SIZES };
+
+/* Slab cache of one block size:
+ *   full:    pages without free block
+ *   partial: pages with both used and free blocks, by allocation tag of page
+ *   empty:   pages without used block
+ */
+typedef struct mbcq_t {
+    list_head_t full;
+    list_head_t partial[CUPKEE_MTAG_MAX];
+    list_head_t empty;
+
+    uint16_t pages;
+    uint16_t used;
+    uint16_t empty_num;
+} mbcq_t;
+
 static uint8_t memory_zone_num = 0;
+static uint16_t memory_page_used = 0;
+static uint16_t memory_page_peak = 0;
+static uint16_t memory_alloc_fail = 0;
+static cupkee_memory_tag_t memory_tags[CUPKEE_MTAG_MAX];
+
+static const char * const memory_tag_names[CUPKEE_MTAG_MAX] = {
+    "none", "stream", "shell", "sdmp", "device", "user0", "user1", "user2"
+};
 
 static cupkee_zone_t *memory_zone[CUPKEE_ZONE_MAX];
-static list_head_t    memory_mbcq[CUPKEE_MBCQ_MAX];
+static cupkee_zone_t *memory_zone_range[CUPKEE_ZONE_MAX];
+static mbcq_t         memory_mbcq[CUPKEE_MBCQ_MAX];
+static const uint8_t  memory_mbcq_index[] = { MBCQ_INDEX };
 
 static inline size_t zone_block_size(int pages)
 {
     return sizeof(cupkee_zone_t) + sizeof(cupkee_page_t) * pages;
 }
 
+static inline void zone_free_add(cupkee_zone_t *zone, cupkee_page_t *page)
+{
+    list_add(&page->list, &zone->pages_free[page->order]);
+    zone->pages_free_num[page->order]++;
+}
+
+static inline void zone_free_del(cupkee_zone_t *zone, cupkee_page_t *page)
+{
+    list_del(&page->list);
+    zone->pages_free_num[page->order]--;
+}
+
+static inline void page_used_add(int n)
+{
+    memory_page_used += n;
+    if (memory_page_peak < memory_page_used) {
+        memory_page_peak = memory_page_used;
+    }
+}
+
+static inline void page_tag_set(cupkee_page_t *page, int tag)
+{
+    page->flags = (page->flags & ~PAGE_TAG_MASK) | (tag << PAGE_TAG_SHIFT);
+}
+
+static int mtag_charge(int tag, size_t bytes)
+{
+    cupkee_memory_tag_t *t = &memory_tags[tag];
+
+    if (t->quota && t->used + bytes > t->quota) {
+        t->fail++;
+        return -CUPKEE_ENOMEM;
+    }
+    t->used += bytes;
+
+    return 0;
+}
+
+static inline void mtag_uncharge(int tag, size_t bytes)
+{
+    memory_tags[tag].used -= bytes;
+}
+
+static cupkee_page_t *page_alloc(int order, int zone_id);
+
 static inline cupkee_zone_t *page_zone(cupkee_page_t *page) {
     int id = page->flags & PAGE_ZONE_MASK;
 
     return id < memory_zone_num ? memory_zone[id] : NULL;
 }
 
-static int page_clip(int page_num, uint16_t *order)
+static int page_order(size_t size)
+{
+    int order = 0;
+
+    while (size > (CUPKEE_PAGE_SIZE << order)) {
+        if (++order >= CUPKEE_PAGE_ORDERR_MAX) {
+            return -1;
+        }
+    }
+    return order;
+}
+
+static int page_clip(int page_num, uint8_t *order)
 {
     int i;
 
     for (i = CUPKEE_PAGE_ORDERR_MAX - 1; i >= 0; i--) {
         int n = 1 << i;
         if (page_num >= n) {
-            *order = (uint16_t)i;
+            *order = (uint8_t)i;
             return n;
         }
     }
@@ -101,6 +233,7 @@ static int zone_init(cupkee_zone_t *zone, intptr_t page_base, int page_num)
         zone->pages[i].flags = memory_zone_num;
         zone->pages[i].used  = 0;
         zone->pages[i].order = 0;
+        zone->pages[i].mbcq  = 0;
 
         zone->pages[i].blocks = 0;
 
@@ -108,14 +241,14 @@ static int zone_init(cupkee_zone_t *zone, intptr_t page_base, int page_num)
     }
 
     while (page_num > page_off) {
-        uint16_t order;
+        uint8_t order;
         int pages = page_clip(page_num - page_off, &order);
 
         if (pages) {
             zone->pages[page_off].flags |= PAGE_HEAD;
             zone->pages[page_off].order = order;
 
-            list_add(&zone->pages[page_off].list, &zone->pages_free[order]);
+            zone_free_add(zone, &zone->pages[page_off]);
 
             page_off += pages;
         } else {
@@ -131,21 +264,85 @@ static int zone_init(cupkee_zone_t *zone, intptr_t page_base, int page_num)
     return 0;
 }
 
-int cupkee_memory_setup(void)
+static int zone_create(intptr_t mem_base, size_t mem_size)
 {
-    size_t mem_size;
-    size_t zone_size;
-    size_t page_size;
-    intptr_t mem_base;
-    intptr_t mem_end;
+    intptr_t mem_end = mem_base + mem_size;
     intptr_t zone_base;
     intptr_t page_base;
-    cupkee_zone_t *zone;
+    size_t   zone_size;
+    int      page_num;
+
+    zone_base = (intptr_t) CUPKEE_ADDR_ALIGN(mem_base, sizeof(intptr_t));
+    zone_size = zone_block_size(mem_size / CUPKEE_PAGE_SIZE);
+
+    // printf("zone block size: %lu = %lu + %lu * %lu\n", zone_size, sizeof(cupkee_zone_t), sizeof(cupkee_page_t), mem_size / CUPKEE_PAGE_SIZE);
+
+    page_base = (intptr_t) CUPKEE_ADDR_ALIGN((zone_base + zone_size), CUPKEE_PAGE_SIZE);
+    if (page_base + (intptr_t)CUPKEE_PAGE_SIZE > mem_end) {
+        return -CUPKEE_EINVAL;
+    }
+    page_num = (mem_end - page_base) / CUPKEE_PAGE_SIZE;
+
+    // printf("page base: %p, num: %d\n", page_base, page_num);
+
+    if (0 != zone_init((cupkee_zone_t *) zone_base, page_base, page_num)) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    return memory_zone_num - 1;
+}
+
+/* Insert into zone range table, that is sorted by base address */
+static void zone_range_insert(cupkee_zone_t *zone)
+{
+    int i = memory_zone_num - 1;
+
+    while (i > 0 && memory_zone_range[i - 1]->base > zone->base) {
+        memory_zone_range[i] = memory_zone_range[i - 1];
+        i--;
+    }
+    memory_zone_range[i] = zone;
+}
+
+static int zone_range_overlap(intptr_t base, intptr_t end)
+{
     int i;
 
+    for (i = 0; i < memory_zone_num; i++) {
+        cupkee_zone_t *zone = memory_zone[i];
+        // Zone head is placed at the begin of the memory region
+        intptr_t zone_base = (intptr_t) zone;
+        intptr_t zone_end  = zone->base + zone->page_num * CUPKEE_PAGE_SIZE;
+
+        if (base < zone_end && end > zone_base) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int cupkee_memory_setup(void)
+{
+    size_t mem_size;
+    intptr_t mem_base;
+    int i, tag;
+
     memory_zone_num = 0;
-    for (i = 0; i < CUPKEE_MBCQ_MAX; i++) {
-        list_head_init(&memory_mbcq[i]);
+    memory_page_used = 0;
+    memory_page_peak = 0;
+    memory_alloc_fail = 0;
+    memset(memory_tags, 0, sizeof(memory_tags));
+    for (i = 0; i < (int)CUPKEE_MBCQ_MAX; i++) {
+        mbcq_t *q = &memory_mbcq[i];
+
+        list_head_init(&q->full);
+        for (tag = 0; tag < CUPKEE_MTAG_MAX; tag++) {
+            list_head_init(&q->partial[tag]);
+        }
+        list_head_init(&q->empty);
+        q->pages = 0;
+        q->used  = 0;
+        q->empty_num = 0;
     }
 
     /* boot zone init */
@@ -154,46 +351,62 @@ int cupkee_memory_setup(void)
     if (!mem_base) {
         return -1;
     }
-    mem_end = mem_base + mem_size;
 
-    zone_base = (intptr_t) CUPKEE_ADDR_ALIGN(mem_base, sizeof(intptr_t));
-    zone_size = zone_block_size(mem_size / CUPKEE_PAGE_SIZE);
-
-    // printf("zone block size: %lu = %lu + %lu * %lu\n", zone_size, sizeof(cupkee_zone_t), sizeof(cupkee_page_t), mem_size / CUPKEE_PAGE_SIZE);
-
-    page_base = (intptr_t) CUPKEE_ADDR_ALIGN((zone_base + zone_size), CUPKEE_PAGE_SIZE);
-    page_size = mem_end - page_base;
-
-    // printf("page base: %p, size: %lu\n", page_base, page_size);
-
-    zone = (cupkee_zone_t *) zone_base;
+    if (zone_create(mem_base, mem_size) < 0) {
+        return -1;
+    }
+    zone_range_insert(memory_zone[0]);
 
-    return zone_init(zone, page_base, page_size / CUPKEE_PAGE_SIZE);
+    return 0;
 }
 
 int cupkee_memory_extend(intptr_t base, size_t size)
 {
-    (void) base;
-    (void) size;
+    int id;
+
+    if (!base || !size || base + (intptr_t)size < base) {
+        return -CUPKEE_EINVAL;
+    }
 
-    return -1;
+    if (zone_range_overlap(base, base + size)) {
+        return -CUPKEE_EINVAL;
+    }
+
+    id = zone_create(base, size);
+    if (id >= 0) {
+        zone_range_insert(memory_zone[id]);
+    }
+
+    return id;
 }
 
 cupkee_page_t *cupkee_memory_page(void *ptr)
 {
     cupkee_zone_t *zone;
-    intptr_t page_base = (intptr_t) ptr;
-    int i;
+    intptr_t addr = (intptr_t) ptr;
+    int lo = 0, hi = memory_zone_num - 1;
 
-    for (i = 0; i < memory_zone_num; i++) {
-        zone = memory_zone[i];
+    // Find the last zone with base not above addr
+    while (lo < hi) {
+        int mid = (lo + hi + 1) >> 1;
 
-        if (page_base >= zone->base) {
-            unsigned id = (page_base - zone->base) >> CUPKEE_PAGE_SHIFT;
+        if (memory_zone_range[mid]->base <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
 
-            if (id < zone->page_num) {
-                return &zone->pages[id];
-            }
+    if (hi < 0) {
+        return NULL;
+    }
+
+    zone = memory_zone_range[lo];
+    if (addr >= zone->base) {
+        unsigned id = (addr - zone->base) >> CUPKEE_PAGE_SHIFT;
+
+        if (id < zone->page_num) {
+            return &zone->pages[id];
         }
     }
 
@@ -224,14 +437,8 @@ int cupkee_free_pages(int order)
     }
 
     for (i = 0; i < memory_zone_num; i++) {
-        list_head_t *pos;
-        list_head_t *head = &memory_zone[i]->pages_free[order];
-
-        list_for_each(pos, head) {
-            count++;
-        }
+        count += memory_zone[i]->pages_free_num[order];
     }
-    // printf("free page: %d\n", count);
 
     return count;
 }
@@ -240,7 +447,7 @@ static cupkee_page_t *page_division(cupkee_page_t *page)
 {
     cupkee_zone_t *zone;
     cupkee_page_t *buddy;
-    uint16_t order = page->order - 1;
+    uint8_t order = page->order - 1;
 
     if (order >= CUPKEE_PAGE_ORDERR_MAX || NULL == (zone = page_zone(page))) {
         return NULL;
@@ -279,7 +486,7 @@ static cupkee_page_t *page_combine(cupkee_page_t *page, cupkee_zone_t *zone)
     if ((buddy->flags & PAGE_INUSED) || (buddy->order != page->order)) {
         return NULL;
     }
-    list_del(&buddy->list);
+    zone_free_del(zone, buddy);
 
     if (dis < 0) {
         page->flags &= ~PAGE_HEAD;
@@ -303,7 +510,7 @@ static cupkee_page_t *zone_page_alloc(cupkee_zone_t *zone, int order)
     if (!list_is_empty(&zone->pages_free[order])) {
         page = (cupkee_page_t *)(zone->pages_free[order].next);
 
-        list_del(&page->list);
+        zone_free_del(zone, page);
 
         page->flags |= PAGE_INUSED;
 
@@ -313,14 +520,14 @@ static cupkee_page_t *zone_page_alloc(cupkee_zone_t *zone, int order)
     for (supor = order + 1; supor < CUPKEE_PAGE_ORDERR_MAX; supor ++) {
         if(!list_is_empty(&zone->pages_free[supor])) {
             page = (cupkee_page_t *)(zone->pages_free[supor].next);
-            list_del(&page->list);
+            zone_free_del(zone, page);
             while (page->order != order) {
                 cupkee_page_t *buddy = page_division(page);
                 if (!buddy) {
                     return NULL;
                 }
 
-                list_add(&buddy->list, &zone->pages_free[buddy->order]);
+                zone_free_add(zone, buddy);
             }
 
             page->flags |= PAGE_INUSED;
@@ -332,17 +539,18 @@ static cupkee_page_t *zone_page_alloc(cupkee_zone_t *zone, int order)
     return NULL;
 }
 
-static void page_block_init(cupkee_page_t *page, size_t block_size)
+static void page_block_init(cupkee_page_t *page, int q)
 {
     void *mem = cupkee_page_memory(page);
-    int i, max = CUPKEE_PAGE_SIZE / block_size;
+    int i, max = MBLOCK_NUM(q);
     intptr_t head = 0;
 
     page->flags |= PAGE_MBCQ;
     page->used   = 0;
+    page->mbcq   = q;
 
     for (i = 0; i < max; i++) {
-        mblock_head_t *mb = (mblock_head_t *)(mem + block_size * i);
+        mblock_head_t *mb = (mblock_head_t *)(mem + MBLOCK_SIZE(q) * i);
 
         mb->next = head;
         mb->comp = ~(head) + 1;
@@ -374,71 +582,300 @@ static void page_block_free(cupkee_page_t *page, void *b)
     mb->comp = ~(mb->next) + 1;
 
     page->blocks = (intptr_t) mb;
-    if (--page->used == 0) {
+    page->used--;
+}
+
+static inline cupkee_page_t *mbcq_page_first(list_head_t *head)
+{
+    return list_is_empty(head) ? NULL : (cupkee_page_t *)(head->next);
+}
+
+static cupkee_page_t *mbcq_page_get(int q, int tag)
+{
+    mbcq_t *mbcq = &memory_mbcq[q];
+    cupkee_page_t *page;
+
+    // Partial page first, keep the number of pages hold by cache minimal.
+    // Blocks of one page share the tag of page.
+    if (NULL != (page = mbcq_page_first(&mbcq->partial[tag]))) {
+        return page;
+    }
+
+    // Warm page: freelist is still intact, no need to rebuild
+    if (NULL != (page = mbcq_page_first(&mbcq->empty))) {
         list_del(&page->list);
-        cupkee_page_free(page);
+        mbcq->empty_num--;
+    } else
+    if (NULL != (page = page_alloc(0, 0))) {
+        page_block_init(page, q);
+        mbcq->pages++;
+    } else {
+        return NULL;
     }
+    page_tag_set(page, tag);
+
+    list_add(&page->list, &mbcq->partial[tag]);
+
+    return page;
 }
 
-static inline cupkee_page_t *mbcq_page_first(int q)
+static void mbcq_page_release(mbcq_t *mbcq, cupkee_page_t *page)
 {
-    list_head_t *head = &memory_mbcq[q];
+    list_del(&page->list);
 
-    return list_is_empty(head) ? NULL : (cupkee_page_t *)(head->next);
+    mbcq->pages--;
+    cupkee_page_free(page);
 }
 
-static void *mbcq_alloc(size_t size)
+static inline int mbcq_class(size_t size)
+{
+    return memory_mbcq_index[(size + CUPKEE_MUNIT_SIZE - 1) >> CUPKEE_MUNIT_SHIFT];
+}
+
+static int mbcq_class_aligned(size_t size, size_t align)
 {
     int q;
 
-    if (size > MBLOCK_SIZE(2)) {
-        q = 3;
-    } else {
-    if (size > MBLOCK_SIZE(1)) {
-        q = 2;
-    } else
-    if (size > MBLOCK_SIZE(0)) {
-        q = 1;
+    if (size > MBLOCK_MAX) {
+        return 0;
+    }
+
+    for (q = mbcq_class(size); q < (int)CUPKEE_MBCQ_MAX; q++) {
+        if (!(MBLOCK_SIZE(q) & (align - 1))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Blocks are aligned to align, in class with block size of multiple of align */
+static void *mbcq_alloc(size_t size, size_t align, int tag)
+{
+    int q;
+
+    for (q = mbcq_class(size); q < (int)CUPKEE_MBCQ_MAX; q++) {
+        cupkee_page_t *page;
+
+        if (MBLOCK_SIZE(q) & (align - 1)) {
+            continue;
+        }
+
+        page = mbcq_page_get(q, tag);
+
+        if (page) {
+            void *b = page_block_alloc(page);
+
+            if (!page->blocks) {
+                list_del(&page->list);
+                list_add(&page->list, &memory_mbcq[q].full);
+            }
+            memory_mbcq[q].used++;
+
+            return b;
+        }
+    }
+
+    return NULL;
+}
+
+static void mbcq_free(cupkee_page_t *page, void *b)
+{
+    mbcq_t *mbcq = &memory_mbcq[page->mbcq];
+    int full = !page->blocks;
+
+    page_block_free(page, b);
+    mbcq->used--;
+
+    if (page->used == 0) {
+        if (mbcq->empty_num < CUPKEE_MBCQ_WARM_PAGES) {
+            list_del(&page->list);
+            list_add(&page->list, &mbcq->empty);
+            mbcq->empty_num++;
+        } else {
+            mbcq_page_release(mbcq, page);
+        }
     } else
-        q = 0;
+    if (full) {
+        list_del(&page->list);
+        list_add(&page->list, &mbcq->partial[PAGE_TAG(page)]);
     }
+}
 
-    while (q < CUPKEE_MBCQ_MAX) {
-        cupkee_page_t *page = mbcq_page_first(q);
+static int mbcq_trim(void)
+{
+    int q, n = 0;
 
-        if (!page || !page->blocks) {
-            page = cupkee_page_alloc(0);
-            if (page) {
-                page_block_init(page, MBLOCK_SIZE(q));
-                list_add(&page->list, &memory_mbcq[q]);
-            } else {
-                q++;
-                continue;
+    for (q = 0; q < (int)CUPKEE_MBCQ_MAX; q++) {
+        mbcq_t *mbcq = &memory_mbcq[q];
+        cupkee_page_t *page;
+
+        while (NULL != (page = mbcq_page_first(&mbcq->empty))) {
+            mbcq_page_release(mbcq, page);
+            mbcq->empty_num--;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int cupkee_memory_trim(void)
+{
+    return mbcq_trim();
+}
+
+int cupkee_memory_stat(int max, cupkee_memory_stat_t *stat)
+{
+    int q;
+
+    if (!stat) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (q = 0; q < max && q < (int)CUPKEE_MBCQ_MAX; q++) {
+        stat[q].block_size = MBLOCK_SIZE(q);
+        stat[q].block_num  = memory_mbcq[q].pages * MBLOCK_NUM(q);
+        stat[q].block_used = memory_mbcq[q].used;
+        stat[q].pages      = memory_mbcq[q].pages;
+    }
+
+    return q;
+}
+
+int cupkee_memory_info(cupkee_memory_info_t *info)
+{
+    int i, order;
+
+    if (!info) {
+        return -CUPKEE_EINVAL;
+    }
+
+    memset(info, 0, sizeof(cupkee_memory_info_t));
+
+    info->free_order_max = -1;
+    for (i = 0; i < memory_zone_num; i++) {
+        cupkee_zone_t *zone = memory_zone[i];
+
+        info->page_total += zone->page_num;
+        for (order = 0; order < CUPKEE_PAGE_ORDERR_MAX; order++) {
+            int n = zone->pages_free_num[order];
+
+            if (n) {
+                info->page_free += n << order;
+                if (info->free_order_max < order) {
+                    info->free_order_max = order;
+                }
             }
         }
+    }
+    info->page_peak  = memory_page_peak;
+    info->alloc_fail = memory_alloc_fail;
 
-        return page_block_alloc(page);
+    for (i = 0; i < (int)CUPKEE_MBCQ_MAX; i++) {
+        info->slab_pages += memory_mbcq[i].pages;
+        info->slab_used  += memory_mbcq[i].used * MBLOCK_SIZE(i);
     }
 
-    return NULL;
+    return 0;
 }
 
-cupkee_page_t *cupkee_page_alloc(int order)
+int cupkee_memory_quota_set(int tag, size_t quota)
 {
-    int zone_id;
-    cupkee_page_t *page;
+    if (tag < 0 || tag >= CUPKEE_MTAG_MAX) {
+        return -CUPKEE_EINVAL;
+    }
+
+    memory_tags[tag].quota = quota;
+
+    return 0;
+}
+
+int cupkee_memory_tag_info(int tag, cupkee_memory_tag_t *info)
+{
+    if (tag < 0 || tag >= CUPKEE_MTAG_MAX || !info) {
+        return -CUPKEE_EINVAL;
+    }
+
+    *info = memory_tags[tag];
+
+    return 0;
+}
+
+const char *cupkee_memory_tag_name(int tag)
+{
+    if (tag < 0 || tag >= CUPKEE_MTAG_MAX) {
+        return NULL;
+    }
+    return memory_tag_names[tag];
+}
+
+static cupkee_page_t *page_alloc(int order, int zone_id)
+{
+    int i;
+    cupkee_page_t *page = NULL;
 
     if (order >= CUPKEE_PAGE_ORDERR_MAX) {
         return NULL;
     }
 
-    for (zone_id = 0, page = NULL; !page && zone_id < memory_zone_num; zone_id++) {
+    // Preferred zone first, then the others in order of creation
+    if (zone_id >= 0 && zone_id < memory_zone_num) {
         page = zone_page_alloc(memory_zone[zone_id], order);
     }
 
+    for (i = 0; !page && i < memory_zone_num; i++) {
+        if (i != zone_id) {
+            page = zone_page_alloc(memory_zone[i], order);
+        }
+    }
+
+    // Memory pressure: give warm pages of block cache back and try again
+    if (!page && mbcq_trim()) {
+        return page_alloc(order, zone_id);
+    }
+
+    if (page) {
+        page_used_add(1 << order);
+    }
+
     return page;
 }
 
+static cupkee_page_t *page_alloc_tagged(int order, int zone_id, int tag)
+{
+    cupkee_page_t *page;
+
+    if (order >= CUPKEE_PAGE_ORDERR_MAX || mtag_charge(tag, CUPKEE_PAGE_SIZE << order)) {
+        return NULL;
+    }
+
+    if (NULL != (page = page_alloc(order, zone_id))) {
+        page_tag_set(page, tag);
+    } else {
+        mtag_uncharge(tag, CUPKEE_PAGE_SIZE << order);
+    }
+
+    return page;
+}
+
+cupkee_page_t *cupkee_page_alloc_prefer(int order, int zone_id)
+{
+    return page_alloc_tagged(order, zone_id, CUPKEE_MTAG_NONE);
+}
+
+cupkee_page_t *cupkee_page_alloc_tagged(int order, int tag)
+{
+    if (tag < 0 || tag >= CUPKEE_MTAG_MAX) {
+        return NULL;
+    }
+    return page_alloc_tagged(order, 0, tag);
+}
+
+cupkee_page_t *cupkee_page_alloc(int order)
+{
+    return page_alloc_tagged(order, 0, CUPKEE_MTAG_NONE);
+}
+
 void cupkee_page_free(cupkee_page_t *page)
 {
     cupkee_page_t *super;
@@ -450,7 +887,11 @@ void cupkee_page_free(cupkee_page_t *page)
 
     // printf("\nfree: %d, %u\n", page - zone->pages, page->order);
 
-    page->flags &= ~(PAGE_INUSED | PAGE_MBCQ);
+    if (!(page->flags & PAGE_MBCQ)) {
+        mtag_uncharge(PAGE_TAG(page), CUPKEE_PAGE_SIZE << page->order);
+    }
+    page->flags &= ~(PAGE_INUSED | PAGE_MBCQ | PAGE_TAG_MASK);
+    memory_page_used -= 1 << page->order;
 
     while (NULL != (super = page_combine(page, zone))) {
         page = super;
@@ -458,32 +899,69 @@ void cupkee_page_free(cupkee_page_t *page)
 
     // printf("real free: %d, %u\n", page - zone->pages, page->order);
 
-    list_add(&page->list, &zone->pages_free[page->order]);
+    zone_free_add(zone, page);
 }
 
-void *cupkee_malloc(size_t size)
+static void *memory_alloc(size_t size, size_t align, int tag)
 {
-    if (size <= MBLOCK_SIZE(CUPKEE_MBCQ_MAX - 1)) {
-        return mbcq_alloc(size);
-    } else {
-        int order = 0;
+    void *p = NULL;
 
-        while (size > (CUPKEE_PAGE_SIZE << order)) {
-            if (++order >= CUPKEE_PAGE_ORDERR_MAX) {
-                break;
-            }
+    if (mbcq_class_aligned(size, align)) {
+        p = mbcq_alloc(size, align, tag);
+        if (p && mtag_charge(tag, MBLOCK_SIZE(cupkee_memory_page(p)->mbcq))) {
+            mbcq_free(cupkee_memory_page(p), p);
+            p = NULL;
         }
+    } else {
+        // Pages are always aligned to CUPKEE_PAGE_SIZE
+        int order = page_order(size);
 
-        while (order < CUPKEE_PAGE_ORDERR_MAX) {
-            cupkee_page_t *page = cupkee_page_alloc(order++);
+        while (!p && order >= 0 && order < CUPKEE_PAGE_ORDERR_MAX) {
+            cupkee_page_t *page = page_alloc_tagged(order++, 0, tag);
 
             if (page) {
-                return cupkee_page_memory(page);
+                p = cupkee_page_memory(page);
+            } else
+            if (memory_tags[tag].quota) {
+                // Bigger pages would be over quota also
+                break;
             }
         }
     }
 
-    return NULL;
+    if (!p) {
+        memory_alloc_fail++;
+    }
+
+    return p;
+}
+
+void *cupkee_malloc_tagged(size_t size, int tag)
+{
+    if (tag < 0 || tag >= CUPKEE_MTAG_MAX) {
+        return NULL;
+    }
+
+    return memory_alloc(size, 1, tag);
+}
+
+void *cupkee_malloc_aligned(size_t size, size_t align)
+{
+    if (!align || (align & (align - 1)) || align > CUPKEE_PAGE_SIZE) {
+        return NULL;
+    }
+
+    return memory_alloc(size, align, CUPKEE_MTAG_NONE);
+}
+
+void *cupkee_dma_alloc(size_t size)
+{
+    return cupkee_malloc_aligned(CUPKEE_SIZE_ALIGN(size, CUPKEE_DMA_ALIGN), CUPKEE_DMA_ALIGN);
+}
+
+void *cupkee_malloc(size_t size)
+{
+    return cupkee_malloc_tagged(size, CUPKEE_MTAG_NONE);
 }
 
 void  cupkee_free(void *p)
@@ -496,9 +974,118 @@ void  cupkee_free(void *p)
     // assert(page->flags & (PAGE_HEAD | PAGE_INUSED);
 
     if (page->flags & PAGE_MBCQ) {
-        page_block_free(page, p);
+        mtag_uncharge(PAGE_TAG(page), MBLOCK_SIZE(page->mbcq));
+        mbcq_free(page, p);
     } else {
         cupkee_page_free(page);
     }
 }
 
+/* Split tail pages of block back to free lists, until it is of order */
+static void page_shrink(cupkee_page_t *page, cupkee_zone_t *zone, int order)
+{
+    while (page->order > order) {
+        cupkee_page_t *buddy = page_division(page);
+
+        // Buddy of the tail half is the head in used, nothing to combine
+        zone_free_add(zone, buddy);
+        memory_page_used -= 1 << buddy->order;
+    }
+}
+
+/* Combine following free buddies into block, until it is of order */
+static int page_grow(cupkee_page_t *page, cupkee_zone_t *zone, int order)
+{
+    unsigned pos = page - zone->pages;
+    int i;
+
+    if (pos & ((1U << order) - 1) || pos + (1U << order) > zone->page_num) {
+        return -1;
+    }
+
+    for (i = page->order; i < order; i++) {
+        cupkee_page_t *buddy = page + (1 << i);
+
+        if ((buddy->flags & (PAGE_HEAD | PAGE_INUSED)) != PAGE_HEAD || buddy->order != i) {
+            return -1;
+        }
+    }
+
+    for (i = page->order; i < order; i++) {
+        cupkee_page_t *buddy = page + (1 << i);
+
+        zone_free_del(zone, buddy);
+        buddy->flags &= ~PAGE_HEAD;
+        page_used_add(1 << i);
+    }
+    page->order = order;
+
+    return 0;
+}
+
+void *cupkee_realloc(void *p, size_t size)
+{
+    cupkee_page_t *page;
+    size_t hold;
+    void *n;
+    int tag;
+
+    if (!p) {
+        return cupkee_malloc(size);
+    }
+
+    if (!size) {
+        cupkee_free(p);
+        return NULL;
+    }
+
+    if (NULL == (page = cupkee_memory_page(p))) {
+        return NULL;
+    }
+    tag = PAGE_TAG(page);
+
+    if (page->flags & PAGE_MBCQ) {
+        hold = MBLOCK_SIZE(page->mbcq);
+
+        // Block is kept, while the size is still in its class
+        if (size <= hold) {
+            return p;
+        }
+    } else {
+        cupkee_zone_t *zone = page_zone(page);
+        int order = page_order(size);
+
+        if (!zone || order < 0) {
+            return NULL;
+        }
+
+        hold = CUPKEE_PAGE_SIZE << page->order;
+
+        if (order <= page->order) {
+            page_shrink(page, zone, order);
+            mtag_uncharge(tag, hold - (CUPKEE_PAGE_SIZE << order));
+            return p;
+        }
+
+        // Move would be over quota also
+        if (0 != mtag_charge(tag, (CUPKEE_PAGE_SIZE << order) - hold)) {
+            return NULL;
+        }
+        if (0 == page_grow(page, zone, order)) {
+            return p;
+        }
+        mtag_uncharge(tag, (CUPKEE_PAGE_SIZE << order) - hold);
+    }
+
+    // Moved block keeps its tag, and only the new block is counted
+    // against quota, the old one is released once data moved.
+    mtag_uncharge(tag, hold);
+    n = cupkee_malloc_tagged(size, tag);
+    memory_tags[tag].used += hold;
+    if (n) {
+        memcpy(n, p, hold < size ? hold : size);
+        cupkee_free(p);
+    }
+
+    return n;
+}
@@ -19,8 +19,7 @@
 
 #include "cupkee.h"
 
-#define CUPKEE_OBJECT_TAG_MAX   (16)
-#define CUPKEE_OBJECT_NUM_DEF   (32)
+#define OBJECT_USED_WORDS   ((CUPKEE_OBJECT_NUM_MAX + 31) / 32)
 
 typedef struct cupkee_object_info_t {
     size_t size;
@@ -28,15 +27,43 @@ typedef struct cupkee_object_info_t {
     void *meta;
 } cupkee_object_info_t;
 
-static list_head_t      obj_list_head;
+typedef struct object_slot_t {
+    cupkee_object_t *obj;
+    uint8_t          gen;   // Bumped when slot is released, to expire old ids
+} object_slot_t;
+
+typedef struct prop_cache_t {
+    const void *table;
+    const char *key;
+    int         index;
+} prop_cache_t;
+
+static list_head_t      obj_list_head;  // Objects owned by native code
+static list_head_t      obj_lang_head;  // Objects owned by language, not marked in this GC cycle
+static list_head_t      obj_keep_head;  // Objects owned by language, marked in this GC cycle
+static uint8_t          obj_mark;       // KEEP bit of objects marked in this GC cycle
 
-static cupkee_object_t **obj_map;
+static object_slot_t   *obj_map;
 static int              obj_map_size;
 static int              obj_map_num;
+static uint32_t         obj_map_used[OBJECT_USED_WORDS];
+
+static prop_cache_t     prop_cache[CUPKEE_PROP_CACHE_SIZE];
 
 static uint8_t              obj_tag_end;
 static cupkee_object_info_t obj_infos[CUPKEE_OBJECT_TAG_MAX];
 
+static inline int object_refs(cupkee_object_t *obj)
+{
+    return obj->ref & CUPKEE_OBJECT_REF_MASK;
+}
+
+static inline void object_move(cupkee_object_t *obj, list_head_t *head)
+{
+    list_del(&obj->list);
+    list_add_tail(&obj->list, head);
+}
+
 static inline const cupkee_desc_t *object_desc(cupkee_object_t *obj) {
     if (obj && obj->tag < obj_tag_end) {
         return obj_infos[obj->tag].desc;
@@ -45,54 +72,104 @@ static inline const cupkee_desc_t *object_desc(cupkee_object_t *obj) {
     }
 }
 
-static inline void object_map(cupkee_object_t *obj, int id)
+static inline void object_map(cupkee_object_t *obj, int slot)
 {
-    if (!obj_map[id]) {
-        obj->id = id;
-        obj_map[id] = obj;
+    if (!obj_map[slot].obj) {
+        obj->id = (obj_map[slot].gen << CUPKEE_ID_SLOT_BITS) | slot;
+        obj_map[slot].obj = obj;
+        obj_map_used[slot / 32] |= 1U << (slot & 31);
         ++obj_map_num;
     }
 }
 
 static inline void object_unmap(cupkee_object_t *obj)
 {
-    if (obj->id < obj_map_size && obj == obj_map[obj->id]) {
-        obj_map[obj->id] = NULL;
+    int slot = CUPKEE_ID_SLOT(obj->id);
+
+    if (obj->id != CUPKEE_ID_INVALID && slot < obj_map_size && obj == obj_map[slot].obj) {
+        obj_map[slot].obj = NULL;
+        obj_map[slot].gen = (obj_map[slot].gen + 1) & CUPKEE_ID_GEN_MASK;
+        obj_map_used[slot / 32] &= ~(1U << (slot & 31));
         --obj_map_num;
     }
 }
 
+static int object_map_grow(int slot)
+{
+    int size = obj_map_size;
+    object_slot_t *map;
+
+    while (size <= slot) {
+        size *= 2;
+    }
+    if (size > CUPKEE_OBJECT_NUM_MAX) {
+        size = CUPKEE_OBJECT_NUM_MAX;
+    }
+
+    map = cupkee_realloc(obj_map, size * sizeof(object_slot_t));
+    if (!map) {
+        return -1;
+    }
+    memset(map + obj_map_size, 0, (size - obj_map_size) * sizeof(object_slot_t));
+
+    obj_map = map;
+    obj_map_size = size;
+
+    return 0;
+}
+
+/* Lowest free slot, small ids keep event coalescing effective */
 static int object_id_alloc(void)
 {
-    if (obj_map_num < obj_map_size) {
-        int id;
-        for (id = 0; id < obj_map_size; id++) {
-            if (!obj_map[id]) {
-                return id;
+    int i;
+
+    for (i = 0; i < OBJECT_USED_WORDS; i++) {
+        uint32_t bits = ~obj_map_used[i];
+
+        if (bits) {
+            int slot = i * 32 + __builtin_ctz(bits);
+
+            if (slot >= CUPKEE_OBJECT_NUM_MAX) {
+                break;
+            }
+            if (slot >= obj_map_size && object_map_grow(slot)) {
+                break;
             }
+            return slot;
         }
     }
     return -1;
 }
 
 static inline cupkee_object_t *object_get_by_id(int id) {
-    if ((unsigned)id >= (unsigned)obj_map_size) {
+    int slot = CUPKEE_ID_SLOT(id);
+    cupkee_object_t *obj;
+
+    if (id < 0 || slot >= obj_map_size) {
         return NULL;
     }
 
-    return obj_map[id];
+    // Id of released object never hit the new one in the same slot
+    obj = obj_map[slot].obj;
+    return (obj && obj->id == id) ? obj : NULL;
 }
 
 int cupkee_object_setup(void)
 {
     obj_map_size = CUPKEE_OBJECT_NUM_DEF;
-    obj_map = (cupkee_object_t **)cupkee_malloc(obj_map_size * sizeof(void *));
+    obj_map = (object_slot_t *)cupkee_malloc(obj_map_size * sizeof(object_slot_t));
     if (!obj_map) {
         return -1;
     }
-    memset(obj_map, 0, obj_map_size * sizeof(void *));
+    memset(obj_map, 0, obj_map_size * sizeof(object_slot_t));
+    memset(obj_map_used, 0, sizeof(obj_map_used));
 
     list_head_init(&obj_list_head);
+    list_head_init(&obj_lang_head);
+    list_head_init(&obj_keep_head);
+    obj_mark = 0;
+
+    memset(prop_cache, 0, sizeof(prop_cache));
 
     obj_tag_end = 0;
     memset(obj_infos, 0, CUPKEE_OBJECT_TAG_MAX * sizeof(cupkee_object_info_t));
@@ -102,28 +179,82 @@ int cupkee_object_setup(void)
     return 0;
 }
 
-void cupkee_object_gc(void)
+/*
+ * Sweep after GC of language: only objects not marked in this cycle are
+ * visited, marked ones were moved to keep list by cupkee_object_keep.
+ * Return the number of objects released by language.
+ */
+int cupkee_object_gc(void)
 {
-    list_head_t *head = &obj_list_head;
-    list_head_t *curr = head->next;
+    list_head_t *head = &obj_lang_head;
+    int n = 0;
 
-    while (curr != head) {
-        list_head_t *next = curr->next;
-        cupkee_object_t *obj = (cupkee_object_t *)curr;
+    while (!list_is_empty(head)) {
+        cupkee_object_t *obj = (cupkee_object_t *)head->next;
 
-        if (obj->ref & CUPKEE_FLAG_LANG) {
-            if (obj->ref & CUPKEE_FLAG_KEEP) {
-                //console_log("gc keep: %p\r\n", obj);
-                obj->ref &= ~CUPKEE_FLAG_KEEP; // Clear mark for next GC
-            } else {
-                //console_log("gc free: %p\r\n", obj);
-                cupkee_object_destroy(obj);
-            }
+        if (object_refs(obj)) {
+            // Still referenced by native code, hand over to it
+            obj->ref &= ~(CUPKEE_FLAG_LANG | CUPKEE_FLAG_KEEP);
+            object_move(obj, &obj_list_head);
         } else {
-            //console_log("gc ignore: %p\r\n", obj);
+            cupkee_object_destroy(obj);
         }
+        n++;
+    }
 
-        curr = next;
+    // Marked objects are candidates of next cycle, flip the mark instead of clear them
+    if (!list_is_empty(&obj_keep_head)) {
+        __list_add(head, obj_keep_head.prev, obj_keep_head.next);
+        list_head_init(&obj_keep_head);
+    }
+    obj_mark ^= CUPKEE_FLAG_KEEP;
+
+    return n;
+}
+
+void cupkee_object_keep(cupkee_object_t *obj)
+{
+    if (obj && (obj->ref & CUPKEE_FLAG_LANG) && (obj->ref & CUPKEE_FLAG_KEEP) != obj_mark) {
+        obj->ref ^= CUPKEE_FLAG_KEEP;
+        object_move(obj, &obj_keep_head);
+    }
+}
+
+/* Hand over to language, the reference of creator is taken over */
+void cupkee_object_lang(cupkee_object_t *obj)
+{
+    if (obj && !(obj->ref & CUPKEE_FLAG_LANG)) {
+        if (object_refs(obj)) {
+            obj->ref--;
+        }
+        obj->ref = (obj->ref & ~CUPKEE_FLAG_KEEP) | (obj_mark ^ CUPKEE_FLAG_KEEP) | CUPKEE_FLAG_LANG;
+        object_move(obj, &obj_lang_head);
+    }
+}
+
+int cupkee_object_ref(cupkee_object_t *obj)
+{
+    if (!obj) {
+        return -CUPKEE_EINVAL;
+    }
+
+    if (object_refs(obj) == CUPKEE_OBJECT_REF_MASK) {
+        return -CUPKEE_ERESOURCE;
+    }
+
+    obj->ref++;
+    return 0;
+}
+
+void cupkee_object_unref(cupkee_object_t *obj)
+{
+    if (obj && object_refs(obj)) {
+        obj->ref--;
+
+        // Objects owned by language are released by GC
+        if (!object_refs(obj) && !(obj->ref & CUPKEE_FLAG_LANG)) {
+            cupkee_object_destroy(obj);
+        }
     }
 }
 
@@ -147,6 +278,11 @@ int cupkee_object_register(size_t size, const cupkee_desc_t *desc)
         return -1;
     }
 
+    // Binary search requires sorted property table
+    if (!cupkee_prop_sorted(desc->props, desc->prop_num, sizeof(cupkee_prop_t))) {
+        return -1;
+    }
+
     obj_infos[obj_tag_end].size = size;
     obj_infos[obj_tag_end].desc = desc;
 
@@ -201,17 +337,17 @@ cupkee_object_t *cupkee_object_create(int tag)
 
 cupkee_object_t *cupkee_object_create_with_id(int tag)
 {
-    int id;
+    int slot;
     cupkee_object_t *obj;
 
-    if (0 > (id = object_id_alloc())) {
+    if (0 > (slot = object_id_alloc())) {
         return NULL;
     }
 
     if (!(obj = cupkee_object_create(tag))) {
         return NULL;
     } else {
-        object_map(obj, id);
+        object_map(obj, slot);
         return obj;
     }
 }
@@ -240,7 +376,7 @@ void cupkee_object_error_set(cupkee_object_t *obj, int err)
             desc->error_handle(obj->entry, err);
         }
         if (obj->id != CUPKEE_ID_INVALID) {
-            cupkee_object_event_post(obj->id, CUPKEE_EVENT_ERROR);
+            cupkee_object_event_post_data(obj->id, CUPKEE_EVENT_ERROR, err);
         }
     }
 }
@@ -345,10 +481,10 @@ int  cupkee_object_write_sync(cupkee_object_t *obj, size_t n, const void *data)
 
 int cupkee_create_id(int tag)
 {
-    int id;
+    int slot;
     cupkee_object_t *obj;
 
-    if (0 > (id = object_id_alloc())) {
+    if (0 > (slot = object_id_alloc())) {
         return -CUPKEE_ERESOURCE;
     }
 
@@ -356,19 +492,37 @@ int cupkee_create_id(int tag)
         return -CUPKEE_ENOMEM;
     }
 
-    object_map(obj, id);
+    object_map(obj, slot);
 
-    return id;
+    return obj->id;
+}
+
+int cupkee_ref(void *entry)
+{
+    return cupkee_object_ref(CUPKEE_OBJECT_PTR(entry));
+}
+
+void cupkee_unref(void *entry)
+{
+    cupkee_object_unref(CUPKEE_OBJECT_PTR(entry));
 }
 
 int cupkee_release(void *entry)
 {
-    cupkee_object_destroy(CUPKEE_OBJECT_PTR(entry));
+    // Object is destroyed with the last reference
+    cupkee_object_unref(CUPKEE_OBJECT_PTR(entry));
     return 0;
 
     //cupkee_object_event_post(CUPKEE_ENTRY_ID(entry), CUPKEE_EVENT_DESTROY);
 }
 
+int cupkee_id_tag(int id)
+{
+    cupkee_object_t *obj = object_get_by_id(id);
+
+    return obj ? obj->tag : CUPKEE_ID_INVALID;
+}
+
 void *cupkee_id_entry(int id, uint8_t tag)
 {
     cupkee_object_t *obj = object_get_by_id(id);
@@ -483,48 +637,163 @@ int  cupkee_elem_set(void *entry, int i, int t, intptr_t data)
     return desc->elem_set(entry, i, t, data);
 }
 
-int  cupkee_prop_set(void *entry, const char *k, int t, intptr_t data)
+
+int cupkee_elem_get(void *entry, int i, intptr_t *p)
 {
     const cupkee_desc_t *desc = object_desc(CUPKEE_OBJECT_PTR(entry));
 
-    if (!desc || !k) {
+    if (!desc || !p) {
         return -CUPKEE_EINVAL;
     }
 
-    if (!desc->prop_set) {
+    if (!desc->elem_get) {
         return -CUPKEE_EIMPLEMENT;
     }
 
-    return desc->prop_set(entry, k, t, data);
+    return desc->elem_get(entry, i, p);
 }
 
-int cupkee_elem_get(void *entry, int i, intptr_t *p)
+static inline const char *prop_name(const void *table, size_t size, int i)
+{
+    return *(const char **)((const uint8_t *)table + size * i);
+}
+
+/*
+ * Binary search in table of structures begin with name, sorted by name.
+ * Return index of k, or -1 if not found.
+ */
+int cupkee_prop_search(const void *table, int num, size_t size, const char *k)
+{
+    int lo = 0, hi = num - 1;
+
+    if (!table || !k) {
+        return -1;
+    }
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(k, prop_name(table, size, mid));
+
+        if (cmp == 0) {
+            return mid;
+        } else
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Check table of structures begin with name is strictly sorted by name,
+ * as cupkee_prop_search requires.
+ */
+int cupkee_prop_sorted(const void *table, int num, size_t size)
+{
+    int i;
+
+    for (i = 1; i < num; i++) {
+        if (strcmp(prop_name(table, size, i - 1), prop_name(table, size, i)) >= 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Symbols of script are mostly interned, the same address is passed for the
+ * same name, so the index found is cached by address of table and k.
+ * A key buffer may be freed and reused by other name, a hit is confirmed by
+ * the name in table. A miss has nothing to confirm with, it is not cached.
+ */
+int cupkee_prop_search_sym(const void *table, int num, size_t size, const char *k)
+{
+    prop_cache_t *c;
+    int i;
+
+    if (!table || !k) {
+        return -1;
+    }
+
+    c = &prop_cache[(((uintptr_t)k >> 2) ^ ((uintptr_t)table >> 4)) & (CUPKEE_PROP_CACHE_SIZE - 1)];
+    if (c->key == k && c->table == table && !strcmp(prop_name(table, size, c->index), k)) {
+        return c->index;
+    }
+
+    if (0 <= (i = cupkee_prop_search(table, num, size, k))) {
+        c->table = table;
+        c->key   = k;
+        c->index = i;
+    }
+
+    return i;
+}
+
+static int prop_set(void *entry, const char *k, int t, intptr_t data, int sym)
 {
     const cupkee_desc_t *desc = object_desc(CUPKEE_OBJECT_PTR(entry));
+    int i;
 
-    if (!desc || !p) {
+    if (!desc || !k) {
         return -CUPKEE_EINVAL;
     }
 
-    if (!desc->elem_get) {
-        return -CUPKEE_EIMPLEMENT;
+    i = sym ? cupkee_prop_search_sym(desc->props, desc->prop_num, sizeof(cupkee_prop_t), k)
+            : cupkee_prop_search(desc->props, desc->prop_num, sizeof(cupkee_prop_t), k);
+    if (i >= 0 && desc->props[i].set) {
+        return desc->props[i].set(entry, t, data);
     }
 
-    return desc->elem_get(entry, i, p);
+    if (!desc->prop_set) {
+        return desc->props ? 0 : -CUPKEE_EIMPLEMENT;
+    }
+
+    return desc->prop_set(entry, k, t, data);
 }
 
-int cupkee_prop_get(void *entry, const char *k, intptr_t *p)
+static int prop_get(void *entry, const char *k, intptr_t *p, int sym)
 {
     const cupkee_desc_t *desc = object_desc(CUPKEE_OBJECT_PTR(entry));
+    int i;
 
     if (!desc || !k || !p) {
         return -CUPKEE_EINVAL;
     }
 
+    i = sym ? cupkee_prop_search_sym(desc->props, desc->prop_num, sizeof(cupkee_prop_t), k)
+            : cupkee_prop_search(desc->props, desc->prop_num, sizeof(cupkee_prop_t), k);
+    if (i >= 0 && desc->props[i].get) {
+        return desc->props[i].get(entry, p);
+    }
+
     if (!desc->prop_get) {
-        return -CUPKEE_EIMPLEMENT;
+        return desc->props ? CUPKEE_OBJECT_ELEM_NV : -CUPKEE_EIMPLEMENT;
     }
 
     return desc->prop_get(entry, k, p);
 }
 
+int cupkee_prop_set(void *entry, const char *k, int t, intptr_t data)
+{
+    return prop_set(entry, k, t, data, 0);
+}
+
+int cupkee_prop_get(void *entry, const char *k, intptr_t *p)
+{
+    return prop_get(entry, k, p, 0);
+}
+
+int cupkee_prop_set_sym(void *entry, const char *k, int t, intptr_t data)
+{
+    return prop_set(entry, k, t, data, 1);
+}
+
+int cupkee_prop_get_sym(void *entry, const char *k, intptr_t *p)
+{
+    return prop_get(entry, k, p, 1);
+}
+
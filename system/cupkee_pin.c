@@ -43,23 +43,31 @@ static const cupkee_pinmap_t *pin_map = NULL;
 
 static uint8_t  pin_group_tag;
 static pin_event_handle_info_t *pin_event_handle_head;
+static cupkee_pool_t pin_event_handle_pool;
 
 static int pin_group_set (void *entry, int t, intptr_t v);
 static int pin_group_set_elem (void *entry, int i, int t, intptr_t v);
 static int pin_group_get_elem (void *entry, int i, intptr_t *p);
-static int pin_group_get_prop (void *entry, const char *k, intptr_t *p);
+static int pin_group_length_get(void *entry, intptr_t *p);
 static void pin_group_destroy(void *entry);
 
+// Sorted by name
+static const cupkee_prop_t pin_group_props[] = {
+    {"length", pin_group_length_get, NULL},
+};
+
 static const cupkee_desc_t pin_group_desc = {
     .name         = "PinGroup",
 
+    .props        = pin_group_props,
+    .prop_num     = sizeof(pin_group_props) / sizeof(cupkee_prop_t),
+
     .destroy      = pin_group_destroy,
 
     .set          = pin_group_set,
 
     .elem_get     = pin_group_get_elem,
     .elem_set     = pin_group_set_elem,
-    .prop_get     = pin_group_get_prop,
 };
 
 static inline int pin_is_valid(uint8_t pin) {
@@ -80,7 +88,7 @@ static int pin_group_set_elem (void *entry, int i, int t, intptr_t v)
 {
     pin_group_t *g = entry;
 
-    if (g && t == CUPKEE_OBJECT_ELEM_INT && i >= 0 && i < g->max) {
+    if (g && t == CUPKEE_OBJECT_ELEM_INT && i >= 0 && i < g->num) {
         uint8_t pin = g->pin[i];
 
         if (pin_is_valid(pin)) {
@@ -94,7 +102,7 @@ static int pin_group_get_elem (void *entry, int i, intptr_t *p)
 {
     pin_group_t *g = entry;
 
-    if (g && i >= 0 && i < g->max) {
+    if (g && i >= 0 && i < g->num) {
         uint8_t pin = g->pin[i];
 
         if (pin_is_valid(pin)) {
@@ -105,11 +113,11 @@ static int pin_group_get_elem (void *entry, int i, intptr_t *p)
     return CUPKEE_OBJECT_ELEM_NV;
 }
 
-static int pin_group_get_prop (void *entry, const char *k, intptr_t *p)
+static int pin_group_length_get(void *entry, intptr_t *p)
 {
     pin_group_t *g = entry;
 
-    if (g && !strcmp(k, "length")) {
+    if (g) {
         *p = g->num;
         return CUPKEE_OBJECT_ELEM_INT;
     } else {
@@ -128,7 +136,7 @@ static void pin_group_destroy(void *entry)
 
 static int pin_event_handle_set(int pin, cupkee_callback_t handler, void *entry)
 {
-    pin_event_handle_info_t *info = cupkee_malloc(sizeof(pin_event_handle_info_t));
+    pin_event_handle_info_t *info = cupkee_pool_get(&pin_event_handle_pool);
 
     if (info) {
         info->next = pin_event_handle_head;
@@ -161,7 +169,7 @@ static void pin_event_handle_clear(int pin)
             if (curr->handler) {
                 curr->handler(curr->entry, CUPKEE_EVENT_PIN_IGNORE, pin);
             }
-            cupkee_free(curr);
+            cupkee_pool_put(&pin_event_handle_pool, curr);
         } else {
             prev = curr;
         }
@@ -176,6 +184,7 @@ int cupkee_pin_setup(void)
     pin_num = 0;
     pin_map = NULL;
     pin_event_handle_head = NULL;
+    cupkee_pool_init(&pin_event_handle_pool, sizeof(pin_event_handle_info_t), CUPKEE_PIN_HANDLE_POOL_GROW, NULL, 0);
 
     tag = cupkee_object_register(sizeof(pin_group_t), &pin_group_desc);
     if (tag < 0) {
@@ -0,0 +1,104 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee.h"
+
+typedef struct pool_node_t {
+    struct pool_node_t *next;
+} pool_node_t;
+
+static void pool_fill(cupkee_pool_t *pool, uint8_t *mem, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        pool_node_t *node = (pool_node_t *)(mem + i * pool->size);
+
+        node->next = pool->free;
+        pool->free = node;
+    }
+    pool->total += num;
+}
+
+int cupkee_pool_init(cupkee_pool_t *pool, size_t size, int grow, void *storage, size_t storage_size)
+{
+    if (!pool || !size || grow < 0) {
+        return -CUPKEE_EINVAL;
+    }
+
+    size = CUPKEE_SIZE_ALIGN(size, sizeof(void *));
+    if (size > 0xffff || grow > 0xffff) {
+        return -CUPKEE_EINVAL;
+    }
+
+    pool->free   = NULL;
+    pool->size   = size;
+    pool->grow   = grow;
+    pool->total  = 0;
+    pool->used   = 0;
+    pool->peak   = 0;
+    pool->refill = 0;
+
+    if (storage) {
+        uint8_t *mem = (uint8_t *)CUPKEE_ADDR_ALIGN(storage, sizeof(void *));
+        size_t   off = mem - (uint8_t *)storage;
+
+        if (storage_size > off) {
+            pool_fill(pool, mem, (storage_size - off) / size);
+        }
+    }
+
+    return CUPKEE_OK;
+}
+
+void *cupkee_pool_get(cupkee_pool_t *pool)
+{
+    pool_node_t *node;
+
+    if (!pool->free && pool->grow) {
+        uint8_t *mem = cupkee_malloc(pool->size * pool->grow);
+
+        if (mem) {
+            pool_fill(pool, mem, pool->grow);
+            pool->refill++;
+        }
+    }
+
+    if (NULL != (node = pool->free)) {
+        pool->free = node->next;
+
+        if (++pool->used > pool->peak) {
+            pool->peak = pool->used;
+        }
+    }
+
+    return node;
+}
+
+void cupkee_pool_put(cupkee_pool_t *pool, void *obj)
+{
+    pool_node_t *node = obj;
+
+    if (node) {
+        node->next = pool->free;
+        pool->free = node;
+        pool->used--;
+    }
+}
+
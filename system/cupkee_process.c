@@ -29,6 +29,13 @@ typedef struct cupkee_process_t {
     void (*finish) (int state, intptr_t data);
 } cupkee_process_t;
 
+static cupkee_pool_t process_pool;
+
+void cupkee_process_setup(void)
+{
+    cupkee_pool_init(&process_pool, sizeof(cupkee_process_t), CUPKEE_PROCESS_POOL_GROW, NULL, 0);
+}
+
 int cupkee_process_start(void (*fn)(void *entry), intptr_t data, void (*finish)(int state, intptr_t data))
 {
     cupkee_process_t *_entry;
@@ -37,7 +44,7 @@ int cupkee_process_start(void (*fn)(void *entry), intptr_t data, void (*finish)(
         return -CUPKEE_EINVAL;
     }
 
-    _entry = cupkee_malloc(sizeof(cupkee_process_t));
+    _entry = cupkee_pool_get(&process_pool);
     if (!_entry) {
         return -CUPKEE_ENOMEM;
     }
@@ -108,7 +115,7 @@ void cupkee_process_done(void *entry)
         _entry->finish(CUPKEE_OK, _entry->data);
     }
 
-    cupkee_free(entry);
+    cupkee_pool_put(&process_pool, entry);
 }
 
 void cupkee_process_fail(void *entry, int err)
@@ -123,6 +130,6 @@ void cupkee_process_fail(void *entry, int err)
         _entry->finish(err, _entry->data);
     }
 
-    cupkee_free(entry);
+    cupkee_pool_put(&process_pool, entry);
 }
 
@@ -0,0 +1,90 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee.h"
+
+#if CUPKEE_EVENT_PROFILE
+
+static cupkee_profile_hist_t profile_types[EVENT_TYPE_MAX];
+static cupkee_profile_hist_t profile_tags[CUPKEE_OBJECT_TAG_MAX];
+
+static inline int profile_bucket(uint32_t v)
+{
+    int n = v ? 32 - __builtin_clz(v) : 0;
+
+    return n < CUPKEE_EVENT_PROFILE_BUCKETS ? n : CUPKEE_EVENT_PROFILE_BUCKETS - 1;
+}
+
+static inline void profile_hist_add(cupkee_profile_hist_t *h, uint32_t wait, uint32_t run)
+{
+    h->wait[profile_bucket(wait)]++;
+    h->run[profile_bucket(run)]++;
+}
+
+void cupkee_profile_reset(void)
+{
+    memset(profile_types, 0, sizeof(profile_types));
+    memset(profile_tags, 0, sizeof(profile_tags));
+}
+
+void cupkee_profile_event(const cupkee_event_t *e, int tag, uint32_t wait, uint32_t run)
+{
+    if (e->type < EVENT_TYPE_MAX) {
+        profile_hist_add(&profile_types[e->type], wait, run);
+    }
+    if (tag >= 0 && tag < CUPKEE_OBJECT_TAG_MAX) {
+        profile_hist_add(&profile_tags[tag], wait, run);
+    }
+}
+
+const cupkee_profile_hist_t *cupkee_profile_hist(int kind, int index)
+{
+    if (kind == CUPKEE_PROFILE_TYPE && index >= 0 && index < EVENT_TYPE_MAX) {
+        return &profile_types[index];
+    } else
+    if (kind == CUPKEE_PROFILE_TAG && index >= 0 && index < CUPKEE_OBJECT_TAG_MAX) {
+        return &profile_tags[index];
+    }
+    return NULL;
+}
+
+#else
+
+void cupkee_profile_reset(void)
+{
+}
+
+void cupkee_profile_event(const cupkee_event_t *e, int tag, uint32_t wait, uint32_t run)
+{
+    (void) e;
+    (void) tag;
+    (void) wait;
+    (void) run;
+}
+
+const cupkee_profile_hist_t *cupkee_profile_hist(int kind, int index)
+{
+    (void) kind;
+    (void) index;
+
+    return NULL;
+}
+
+#endif /* CUPKEE_EVENT_PROFILE */
+
@@ -29,6 +29,7 @@
 
 #define SDMP_SEND_BUF_SIZE      248
 #define SDMP_MSG_BUF_SIZE       (SDMP_HEAD_SIZE + SDMP_BODY_MAX_SIZE)
+#define SDMP_SPACE_UNKNOWN      ((size_t)-1)    // write until the stream is full
 
 enum sdmp_demux_state_e {
     DEMUX_KEY = 0,
@@ -64,6 +65,9 @@ enum sdmp_message_code_e {
     SDMP_REQ_QUERY_APPDATA,
     SDMP_REQ_WRITE_APPDATA,
 
+    SDMP_REQ_QUERY_MEMINFO,
+    SDMP_REQ_QUERY_PROFILE,
+
     SDMP_RESPONSE = 0x80,
     SDMP_REPORT   = 0x81,
 };
@@ -88,6 +92,7 @@ static cupkee_buffer_t sdmp_mux_text_buf;
 
 static uint16_t sdmp_script_buf_size = 0;
 static char *   sdmp_script_buf = NULL;
+static cupkee_arena_t sdmp_script_arena;
 
 static void (*sdmp_text_handler)(int, const void *) = NULL;
 static int (*sdmp_user_call_handler)(int, void *) = NULL;
@@ -95,13 +100,16 @@ static int (*sdmp_user_query_handler)(uint16_t flags) = NULL;
 
 static int sdmp_request_filter(uint8_t);
 
-static void sdmp_do_recv(void *tty)
+/* n: bytes buffered when the DATA event was posted, bytes arrived later
+ * are announced by another one.
+ */
+static void sdmp_do_recv(void *tty, size_t n)
 {
     uint8_t byte;
     char buf[4];
     int  pos = 0;
 
-    while (0 < cupkee_read(tty, 1, &byte)) {
+    while (n-- > 0 && 0 < cupkee_read(tty, 1, &byte)) {
         if (sdmp_request_filter(byte)) {
             buf[pos++] = byte;
             if (pos >= 3 && sdmp_text_handler) {
@@ -116,7 +124,8 @@ static void sdmp_do_recv(void *tty)
     }
 }
 
-static void sdmp_do_send(void *tty)
+/* space: room to write when the DRAIN event was posted */
+static void sdmp_do_send(void *tty, size_t space)
 {
     uint8_t c;
 
@@ -134,10 +143,11 @@ static void sdmp_do_send(void *tty)
         if (retval < len) {
             return;
         }
+        space = (size_t)retval < space ? space - retval : 0;
     }
 
     // Send text
-    while (cupkee_buffer_shift(&sdmp_mux_text_buf, &c)) {
+    while (space-- > 0 && cupkee_buffer_shift(&sdmp_mux_text_buf, &c)) {
         if (!cupkee_write(tty, 1, &c)) {
             cupkee_buffer_unshift(&sdmp_mux_text_buf, c);
             break;
@@ -176,7 +186,7 @@ static inline int sdmp_message_init(sdmp_message_t *msg, uint8_t code, uint8_t p
 static inline void sdmp_message_send(int len)
 {
     sdmp_message_end += len;
-    sdmp_do_send(sdmp_io_stream);
+    sdmp_do_send(sdmp_io_stream, SDMP_SPACE_UNKNOWN);
 }
 
 static void sdmp_response_status(uint8_t req, uint8_t err)
@@ -194,11 +204,9 @@ static void sdmp_response_status(uint8_t req, uint8_t err)
 
 static inline void sdmp_script_buf_free(void)
 {
-    if (sdmp_script_buf) {
-        cupkee_free(sdmp_script_buf);
-        sdmp_script_buf = NULL;
-    }
+    cupkee_arena_reset(&sdmp_script_arena);
 
+    sdmp_script_buf = NULL;
     sdmp_script_buf_size = 0;
 }
 
@@ -410,10 +418,11 @@ static void sdmp_execute_script(uint16_t req_len, uint8_t *req)
     }
 
     if (cur == 0) {
-        int total = end * 252;
-        sdmp_script_buf_free();
+        // One more byte for string terminator
+        int total = end * 252 + 1;
 
-        sdmp_script_buf = cupkee_malloc(total);
+        sdmp_script_buf_free();
+        sdmp_script_buf = cupkee_arena_alloc(&sdmp_script_arena, total);
         if (!sdmp_script_buf) {
             error = SDMP_MemNotEnought;
             goto DO_ERROR;
@@ -442,6 +451,7 @@ static void sdmp_execute_script(uint16_t req_len, uint8_t *req)
         } else {
             sdmp_response_status(req[0], SDMP_OK);
         }
+        sdmp_script_buf_free();
     } else {
         sdmp_response_cont(req[0], next);
     }
@@ -502,6 +512,85 @@ static void sdmp_write_appdata(uint16_t req_len, uint8_t *req)
     sdmp_response_status(req[0], SDMP_NotImplemented);
 }
 
+static inline void sdmp_put_uint32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) (v);
+}
+
+/* Response data: used(4), quota(4) and fail(2) of each tag, in big endian */
+static void sdmp_query_meminfo(void)
+{
+    sdmp_message_t msg;
+    int len, tag;
+
+    if ((len = sdmp_message_init(&msg, SDMP_RESPONSE, 3, CUPKEE_MTAG_MAX * 10)) > 0) {
+        msg.param[0] = SDMP_REQ_QUERY_MEMINFO;
+        msg.param[1] = SDMP_OK;
+        msg.param[2] = CUPKEE_MTAG_MAX;
+
+        for (tag = 0; tag < CUPKEE_MTAG_MAX; tag++) {
+            cupkee_memory_tag_t info;
+            uint8_t *p = msg.data + tag * 10;
+
+            cupkee_memory_tag_info(tag, &info);
+            sdmp_put_uint32(p, info.used);
+            sdmp_put_uint32(p + 4, info.quota);
+            p[8] = (uint8_t) (info.fail >> 8);
+            p[9] = (uint8_t) (info.fail);
+        }
+
+        sdmp_message_send(len);
+    } else {
+        sdmp_response_status(SDMP_REQ_QUERY_MEMINFO, SDMP_MemNotEnought);
+    }
+}
+
+/* Request param: kind(1), index(1), as cupkee_profile_hist
+ * Response data: wait and run buckets(4 each) in big endian
+ */
+static void sdmp_query_profile(uint16_t req_len, uint8_t *req)
+{
+    const cupkee_profile_hist_t *h;
+    sdmp_message_t msg;
+    int len, i;
+
+    if (req_len < 3) {
+        sdmp_response_status(SDMP_REQ_QUERY_PROFILE, SDMP_InvalidParam);
+        return;
+    }
+
+    if (!cupkee_profile_hist(CUPKEE_PROFILE_TYPE, 0)) {
+        sdmp_response_status(SDMP_REQ_QUERY_PROFILE, SDMP_NotImplemented);
+        return;
+    }
+
+    h = cupkee_profile_hist(req[1], req[2]);
+    if (!h) {
+        sdmp_response_status(SDMP_REQ_QUERY_PROFILE, SDMP_InvalidParam);
+        return;
+    }
+
+    if ((len = sdmp_message_init(&msg, SDMP_RESPONSE, 5, CUPKEE_EVENT_PROFILE_BUCKETS * 8)) > 0) {
+        msg.param[0] = SDMP_REQ_QUERY_PROFILE;
+        msg.param[1] = SDMP_OK;
+        msg.param[2] = req[1];
+        msg.param[3] = req[2];
+        msg.param[4] = CUPKEE_EVENT_PROFILE_BUCKETS;
+
+        for (i = 0; i < CUPKEE_EVENT_PROFILE_BUCKETS; i++) {
+            sdmp_put_uint32(msg.data + i * 4, h->wait[i]);
+            sdmp_put_uint32(msg.data + (CUPKEE_EVENT_PROFILE_BUCKETS + i) * 4, h->run[i]);
+        }
+
+        sdmp_message_send(len);
+    } else {
+        sdmp_response_status(SDMP_REQ_QUERY_PROFILE, SDMP_MemNotEnought);
+    }
+}
+
 static void sdmp_request_handler(uint16_t len, uint8_t *req)
 {
     uint8_t code = req[0];
@@ -521,6 +610,9 @@ static void sdmp_request_handler(uint16_t len, uint8_t *req)
     case SDMP_REQ_QUERY_APPSTATE:   sdmp_query_appstate(len, req); break;
     case SDMP_REQ_QUERY_APPDATA:    sdmp_query_appdata(len, req); break;
     case SDMP_REQ_WRITE_APPDATA:    sdmp_write_appdata(len, req); break;
+
+    case SDMP_REQ_QUERY_MEMINFO:    sdmp_query_meminfo(); break;
+    case SDMP_REQ_QUERY_PROFILE:    sdmp_query_profile(len, req); break;
     default: sdmp_response_status(code, SDMP_InvalidReq);
     }
 }
@@ -578,10 +670,10 @@ static int sdmp_stream_handle(void *tty, int event, intptr_t param)
     (void) param;
 
     if (event == CUPKEE_EVENT_DATA) {
-        sdmp_do_recv(tty);
+        sdmp_do_recv(tty, cupkee_event_data());
     } else
     if (event == CUPKEE_EVENT_DRAIN) {
-        sdmp_do_send(tty);
+        sdmp_do_send(tty, cupkee_event_data());
     }
 
     return 0;
@@ -598,6 +690,7 @@ int cupkee_sdmp_init(void *stream)
 
     sdmp_script_buf_size = 0;
     sdmp_script_buf = NULL;
+    cupkee_arena_init(&sdmp_script_arena, 0, CUPKEE_MTAG_SDMP);
 
     memset(sdmp_app_interface, 0, CUPKEE_UID_SIZE);
 
@@ -612,7 +705,7 @@ int cupkee_sdmp_init(void *stream)
     cupkee_listen(stream, CUPKEE_EVENT_DATA);
     cupkee_listen(stream, CUPKEE_EVENT_DRAIN);
 
-    if (!cupkee_buffer_alloc(&sdmp_mux_text_buf, SDMP_SEND_BUF_SIZE)) {
+    if (!cupkee_buffer_alloc_tagged(&sdmp_mux_text_buf, SDMP_SEND_BUF_SIZE, CUPKEE_MTAG_SDMP)) {
         return -CUPKEE_ERESOURCE;
     }
 
@@ -628,7 +721,7 @@ int cupkee_sdmp_tty_write(size_t len, const char *text)
         int cached = cupkee_buffer_give(&sdmp_mux_text_buf, len, text);
 
         if (cached > 0 && (size_t) cached == cupkee_buffer_length(&sdmp_mux_text_buf)) {
-            sdmp_do_send(sdmp_io_stream);
+            sdmp_do_send(sdmp_io_stream, SDMP_SPACE_UNKNOWN);
         }
         return cached;
     } else {
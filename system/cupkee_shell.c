@@ -49,7 +49,7 @@ static void shell_memory_location(int *heap_mem_sz, int *stack_mem_sz)
     int core_blocks;
 
     size = 16 * 1024;
-    memory = cupkee_malloc(size);
+    memory = cupkee_malloc_tagged(size, CUPKEE_MTAG_SHELL);
     if (!memory) {
         // memory not enought !
         hw_halt();
@@ -205,6 +205,7 @@ static void shell_env_callback(env_t *env, int event)
 {
     if (event == PANDA_EVENT_GC_START) {
         shell_reference_gc(env);
+        shell_timeout_gc(env);
     } else
     if (event == PANDA_EVENT_GC_END) {
         cupkee_object_gc();
@@ -220,6 +221,7 @@ static void shell_interp_init(int heap_mem_sz, int stack_mem_sz, int n, const na
     }
 
     shell_reference_init(&shell_env);
+    shell_timeout_init();
 
     env_native_set(&shell_env, entrys, n);
 
@@ -251,9 +253,7 @@ val_t foreign_set(void *env, val_t *self, val_t *data)
 
 void foreign_keep(intptr_t entry)
 {
-    cupkee_object_t *obj = CUPKEE_OBJECT_PTR(entry);
-
-    obj->ref |= CUPKEE_FLAG_KEEP;
+    cupkee_object_keep(CUPKEE_OBJECT_PTR(entry));
 }
 
 int foreign_is_true(val_t *self)
@@ -285,14 +285,22 @@ val_t foreign_get_prop(void *env, val_t *self, const char *key)
     (void) env;
 
     meta = cupkee_meta(entry);
-    if (meta && meta->prop_get) {
+    if (meta) {
+        int i = cupkee_prop_search_sym(meta->methods, meta->method_num, sizeof(native_t), key);
         val_t prop;
-        if (meta->prop_get(entry, key, &prop) > 0) {
+
+        if (i >= 0) {
+            val_set_native(&prop, (intptr_t)meta->methods[i].fn);
+            return prop;
+        }
+        if (meta->prop_get && meta->prop_get(entry, key, &prop) > 0) {
             return prop;
         }
     }
 
-    t = cupkee_prop_get(entry, key, &v);
+    // Key of property access is mostly interned by interpreter, computed
+    // keys may be heap strings: cached lookup confirms the name
+    t = cupkee_prop_get_sym(entry, key, &v);
     switch (t) {
     case CUPKEE_OBJECT_ELEM_INT:
         return val_mk_number(v);
@@ -342,10 +350,10 @@ void foreign_set_prop(void *env, val_t *self, const char *key, val_t *data)
     (void) env;
 
     if (val_is_number(data)) {
-        cupkee_prop_set(entry, key, CUPKEE_OBJECT_ELEM_INT, val_2_integer(data));
+        cupkee_prop_set_sym(entry, key, CUPKEE_OBJECT_ELEM_INT, val_2_integer(data));
     } else
     if (val_is_string(data)) {
-        cupkee_prop_set(entry, key, CUPKEE_OBJECT_ELEM_STR, (intptr_t)val_2_cstring(data));
+        cupkee_prop_set_sym(entry, key, CUPKEE_OBJECT_ELEM_STR, (intptr_t)val_2_cstring(data));
     } else
     if (val_is_array(data)){
         array_t *array = (array_t *)val_2_intptr(data);
@@ -353,7 +361,7 @@ void foreign_set_prop(void *env, val_t *self, const char *key, val_t *data)
         int n = array_length(array), i;
 
         for (i = 0; i < n; i++, elems++) {
-            if (val_is_number(elems) && cupkee_prop_set(entry, key, CUPKEE_OBJECT_ELEM_INT, val_2_integer(elems)) < 1) {
+            if (val_is_number(elems) && cupkee_prop_set_sym(entry, key, CUPKEE_OBJECT_ELEM_INT, val_2_integer(elems)) < 1) {
                 break;
             }
         }
@@ -428,8 +436,10 @@ int cupkee_shell_init(int n, const native_t *natives)
 
     shell_interp_init(heap_mem_sz, stack_mem_sz, n, natives);
 
-    shell_timer_init();
-    shell_device_init();
+    if (shell_timer_init() || shell_device_init()) {
+        console_puts_sync("method table not sorted\r\n");
+        return -1;
+    }
 
     console_puts_sync(logo);
 
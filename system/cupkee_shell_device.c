@@ -97,29 +97,20 @@ static val_t native_device_disable(env_t *env, int ac, val_t *av)
     return cupkee_device_disable(dev) == 0 ? VAL_TRUE : VAL_FALSE;
 }
 
-static int device_prop_get(void *entry, const char *key, val_t *prop)
-{
-    (void) entry;
-
-    if (!strcmp(key, "enable")) {
-        val_set_native(prop, (intptr_t)native_device_enable);
-        return 1;
-    } else
-    if (!strcmp(key, "disable")) {
-        val_set_native(prop, (intptr_t)native_device_disable);
-        return 1;
-    } else {
-        return 0;
-    }
-}
+// Sorted by name
+static const native_t device_methods[] = {
+    {"disable", native_device_disable},
+    {"enable",  native_device_enable},
+};
 
 static const cupkee_meta_t device_meta = {
-    .prop_get = device_prop_get
+    .methods    = device_methods,
+    .method_num = sizeof(device_methods) / sizeof(native_t),
 };
 
-void shell_device_init(void)
+int shell_device_init(void)
 {
-    cupkee_object_set_meta(cupkee_device_tag(), (void *)&device_meta);
+    return shell_object_meta_set(cupkee_device_tag(), &device_meta);
 }
 
 val_t native_create_device(env_t *env, int ac, val_t *av)
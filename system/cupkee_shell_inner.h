@@ -32,17 +32,22 @@ void shell_reference_gc(env_t *env);
 void shell_print_value(val_t *v);
 void shell_print_error(int error);
 
+// cupkee_shell_timeout.c
+void shell_timeout_init(void);
+void shell_timeout_gc(env_t *env);
+
 // cupkee_shell_timer.c
-void shell_timer_init(void);
+int shell_timer_init(void);
 
 // cupkee_shell_object.c
 void shell_object_gc(void *env);
+int shell_object_meta_set(int tag, const cupkee_meta_t *meta);
 
 // cupkee_shell_sdmp.c
 void shell_sdmp_init(void);
 
 // cupkee_shell_device.c
-void shell_device_init(void);
+int shell_device_init(void);
 
 #endif /* __CUPKEE_SHELL_INNER_INC__ */
 
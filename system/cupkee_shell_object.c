@@ -24,14 +24,24 @@ val_t cupkee_shell_object_create(env_t *env, void *entry)
 {
     (void) env;
     if (entry) {
-        cupkee_object_t *obj = CUPKEE_OBJECT_PTR(entry);
-        obj->ref |= CUPKEE_FLAG_LANG;
+        cupkee_object_lang(CUPKEE_OBJECT_PTR(entry));
         return val_mk_foreign((intptr_t)entry);
     } else {
         return VAL_UNDEFINED;
     }
 }
 
+int shell_object_meta_set(int tag, const cupkee_meta_t *meta)
+{
+    // Methods are looked up by binary search
+    if (!cupkee_prop_sorted(meta->methods, meta->method_num, sizeof(native_t))) {
+        return -CUPKEE_EINVAL;
+    }
+    cupkee_object_set_meta(tag, (void *)meta);
+
+    return 0;
+}
+
 void *cupkee_shell_object_entry (val_t *v)
 {
     if (val_is_foreign(v)) {
@@ -22,12 +22,13 @@
 static int pin_handler(void *entry, int event, intptr_t pin)
 {
     if (event) {
-        val_t av[2];
+        val_t av[3];
 
         val_set_number(av, (event & CUPKEE_EVENT_PIN_RISING) ? 1 : 0);
         val_set_number(av + 1, pin);
+        val_set_number(av + 2, cupkee_event_data()); // systicks of edge
 
-        cupkee_execute_function(entry, 2, av);
+        cupkee_execute_function(entry, 3, av);
     } else {
         // ignore
         shell_reference_release(entry);
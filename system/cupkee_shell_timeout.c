@@ -24,21 +24,65 @@
 #define FLAG_TIMEOUT      (0x80)
 #define FLAG_INTERVAL     (0x80 | CUPKEE_FLAG_REPEAT)
 
+// Callbacks of timeouts, indexed by slot of timeout id, grow with the timeout map
+static val_t *timeout_funcs;
+static int    timeout_funcs_size;
+
+static int timeout_funcs_grow(int slot)
+{
+    int size = timeout_funcs_size ? timeout_funcs_size : CUPKEE_TIMEOUT_NUM_DEF;
+    val_t *funcs;
+    int i;
+
+    while (size <= slot) {
+        size *= 2;
+    }
+
+    if (timeout_funcs) {
+        funcs = cupkee_realloc(timeout_funcs, size * sizeof(val_t));
+    } else {
+        funcs = cupkee_malloc_tagged(size * sizeof(val_t), CUPKEE_MTAG_SHELL);
+    }
+    if (!funcs) {
+        return -1;
+    }
+
+    for (i = timeout_funcs_size; i < size; i++) {
+        val_set_undefined(&funcs[i]);
+    }
+    timeout_funcs = funcs;
+    timeout_funcs_size = size;
+
+    return 0;
+}
+
+/* param: the timeout itself, array of callbacks may be moved by grow */
 static void timeout_handle(int drop, void *param)
 {
+    cupkee_timeout_t *timeout = param;
+    val_t *func;
+
+    if (!timeout) {
+        return; // dropped before its callback set
+    }
+    func = &timeout_funcs[cupkee_timeout_slot(timeout->id)];
+
     if (drop) {
-        shell_reference_release(param);
+        val_set_undefined(func);
     } else {
-        cupkee_execute_function(param, 0, NULL);
+        val_t av;
+
+        val_set_number(&av, cupkee_timeout_missed()); // periods missed of interval
+        cupkee_execute_function(func, 1, &av);
     }
 }
 
 static int timeout_register(int ac, val_t *av, int flags)
 {
     val_t   *handle;
-    uint32_t wait;
+    uint32_t wait, slack = 0;
     cupkee_timeout_t *timeout;
-    val_t *ref;
+    int slot;
 
     if (ac < 1 || !val_is_function(av)) {
         return -1;
@@ -52,17 +96,25 @@ static int timeout_register(int ac, val_t *av, int flags)
         wait = 0;
     }
 
-    ref = shell_reference_create(handle);
-    if (!ref) {
-        return -1;
+    // Optional slack, for batching with other timeouts expired nearby
+    if (ac > 2 && val_is_number(av + 1)) {
+        slack = val_2_double(av + 1);
     }
 
-    timeout = cupkee_timeout_register(wait, flags, timeout_handle, ref);
+    timeout = cupkee_timeout_register_ext(wait, slack, flags, timeout_handle, NULL);
     if (!timeout) {
-        shell_reference_release(ref);
         return -1;
     }
 
+    slot = cupkee_timeout_slot(timeout->id);
+    if (slot >= timeout_funcs_size && timeout_funcs_grow(slot)) {
+        cupkee_timeout_unregister(timeout);
+        return -1;
+    }
+
+    timeout->param = timeout;
+    timeout_funcs[slot] = *handle;
+
     return timeout->id;
 }
 
@@ -85,6 +137,20 @@ static int timeout_unregister(int ac, val_t *av, int flags)
     }
 }
 
+void shell_timeout_init(void)
+{
+    // Allocated by the first timeout registered
+    timeout_funcs = NULL;
+    timeout_funcs_size = 0;
+}
+
+void shell_timeout_gc(env_t *env)
+{
+    if (timeout_funcs) {
+        gc_types_copy(env, timeout_funcs_size, timeout_funcs);
+    }
+}
+
 val_t native_set_timeout(env_t *env, int ac, val_t *av)
 {
     int tid = timeout_register(ac, av, FLAG_TIMEOUT);
@@ -41,7 +41,10 @@ static int timer_callback(void *entry, int event, intptr_t data)
 
     case CUPKEE_EVENT_REWIND:
         if (param && param->handle) {
-            val_t ret = cupkee_execute_function(param->handle, 0, NULL);
+            val_t ret, av;
+
+            val_set_number(&av, cupkee_event_data()); // systicks of rewind
+            ret = cupkee_execute_function(param->handle, 1, &av);
 
             if (val_is_number(&ret)) {
                 retval = val_2_integer(&ret);
@@ -126,29 +129,20 @@ static val_t native_timer_stop(env_t *env, int ac, val_t *av)
     return cupkee_timer_stop(timer) == 0 ? VAL_TRUE : VAL_FALSE;
 }
 
-static int timer_prop_get(void *entry, const char *key, val_t *prop)
-{
-    (void) entry;
-
-    if (!strcmp(key, "start")) {
-        val_set_native(prop, (intptr_t)native_timer_start);
-        return 1;
-    } else
-    if (!strcmp(key, "stop")) {
-        val_set_native(prop, (intptr_t)native_timer_stop);
-        return 1;
-    } else {
-        return 0;
-    }
-}
+// Sorted by name
+static const native_t timer_methods[] = {
+    {"start", native_timer_start},
+    {"stop",  native_timer_stop},
+};
 
 static const cupkee_meta_t timer_meta = {
-    .prop_get = timer_prop_get
+    .methods    = timer_methods,
+    .method_num = sizeof(timer_methods) / sizeof(native_t),
 };
 
-void shell_timer_init(void)
+int shell_timer_init(void)
 {
-    cupkee_object_set_meta(cupkee_timer_tag(), (void *)&timer_meta);
+    return shell_object_meta_set(cupkee_timer_tag(), &timer_meta);
 }
 
 val_t native_create_timer(env_t *env, int ac, val_t *av)
@@ -159,7 +153,7 @@ val_t native_create_timer(env_t *env, int ac, val_t *av)
     (void) ac;
     (void) av;
 
-    param = (timer_param_t *) cupkee_malloc(sizeof(timer_param_t));
+    param = (timer_param_t *) cupkee_malloc_tagged(sizeof(timer_param_t), CUPKEE_MTAG_SHELL);
     if (!param) {
         return VAL_UNDEFINED;
     }
@@ -0,0 +1,92 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee_shell_inner.h"
+
+static int topic_handler(void *entry, int topic, intptr_t value)
+{
+    if (topic == CUPKEE_TOPIC_DROP) {
+        shell_reference_release(entry);
+    } else {
+        val_t av[2];
+
+        val_set_number(av, (uint32_t) value);
+        val_set_number(av + 1, topic);
+
+        cupkee_execute_function(entry, 2, av);
+    }
+    return 0;
+}
+
+/* on(topic, fn): return subscriber id */
+val_t native_topic_on(env_t *env, int ac, val_t *av)
+{
+    val_t *ref;
+    int sid;
+
+    (void) env;
+
+    if (ac < 2 || !val_is_number(av) || !val_is_function(av + 1)) {
+        return VAL_UNDEFINED;
+    }
+
+    ref = shell_reference_create(av + 1);
+    if (!ref) {
+        return VAL_UNDEFINED;
+    }
+
+    sid = cupkee_topic_subscribe(val_2_integer(av), topic_handler, ref);
+    if (sid < 0) {
+        shell_reference_release(ref);
+        return VAL_UNDEFINED;
+    }
+
+    return val_mk_number(sid);
+}
+
+/* off(id) */
+val_t native_topic_off(env_t *env, int ac, val_t *av)
+{
+    (void) env;
+
+    if (ac < 1 || !val_is_number(av)) {
+        return VAL_FALSE;
+    }
+
+    return cupkee_topic_unsubscribe(val_2_integer(av)) == CUPKEE_OK ? VAL_TRUE : VAL_FALSE;
+}
+
+/* emit(topic, value) */
+val_t native_topic_emit(env_t *env, int ac, val_t *av)
+{
+    uint32_t value = 0;
+
+    (void) env;
+
+    if (ac < 1 || !val_is_number(av)) {
+        return VAL_FALSE;
+    }
+
+    if (ac > 1 && val_is_number(av + 1)) {
+        value = val_2_integer(av + 1);
+    }
+
+    return cupkee_topic_publish(val_2_integer(av), value) == CUPKEE_OK ? VAL_TRUE : VAL_FALSE;
+}
+
@@ -211,16 +211,35 @@ void shell_print_error(int error)
 val_t native_sysinfos(env_t *env, int ac, val_t *av)
 {
     hw_info_t hw;
+    cupkee_memory_info_t mem;
+    cupkee_defer_stat_t defer;
 
     (void) ac;
     (void) av;
 
     hw_info_get(&hw);
+    cupkee_memory_info(&mem);
 
     console_log_sync("FREQ: %dM\r\n", hw.sys_freq / 1000000);
     console_log_sync("RAM: %dK\r\n", hw.ram_sz / 1024);
     console_log_sync("ROM: %dK\r\n\r\n", hw.rom_sz / 1024);
 
+    console_log_sync("=============================\r\n");
+    console_log_sync("Page: %d/%d, ", mem.page_free, mem.page_total);
+    console_log_sync("Peak: %d, ", mem.page_peak);
+    console_log_sync("Max order: %d, ", mem.free_order_max);
+    console_log_sync("Slab: %d/%d, ", mem.slab_used, mem.slab_pages * CUPKEE_PAGE_SIZE);
+    console_log_sync("Fail: %d\r\n", mem.alloc_fail);
+    cupkee_command_memory(0, NULL);
+    console_log_sync("Event drops: systick %d, object %d, pin %d, topic %d\r\n",
+                     cupkee_event_drops(EVENT_SYSTICK),
+                     cupkee_event_drops(EVENT_OBJECT),
+                     cupkee_event_drops(EVENT_PIN),
+                     cupkee_event_drops(EVENT_TOPIC));
+    cupkee_defer_stat(&defer);
+    console_log_sync("Defer: depth max %d, drops %d, runs %d\r\n",
+                     defer.depth_max, defer.drops, defer.runs);
+
     console_log_sync("=============================\r\n");
     console_log_sync("Symbal: %d/%d, ", env->symbal_tbl_hold, env->symbal_tbl_size);
     console_log_sync("String: %d/%d, ", env->exe.string_num, env->exe.string_max);
@@ -53,14 +53,14 @@ int cupkee_stream_init(
         s->_read = _read;
         s->rx_buf_size = rx_buf_size;
         flags |= CUPKEE_STREAM_FL_READABLE;
-        cupkee_buffer_alloc(&s->rx_buf, rx_buf_size);
+        cupkee_buffer_alloc_tagged(&s->rx_buf, rx_buf_size, CUPKEE_MTAG_STREAM);
     }
 
     if (tx_buf_size && _write) {
         s->_write = _write;
         s->tx_buf_size = tx_buf_size;
         flags |= CUPKEE_STREAM_FL_WRITABLE;
-        cupkee_buffer_alloc(&s->tx_buf, tx_buf_size);
+        cupkee_buffer_alloc_tagged(&s->tx_buf, tx_buf_size, CUPKEE_MTAG_STREAM);
     }
     s->id = id;
     s->rx_state = CUPKEE_STREAM_STATE_IDLE;
@@ -124,7 +124,7 @@ int cupkee_stream_push(cupkee_stream_t *s, size_t n, const void *data)
         int cnt = cupkee_buffer_give(buf, n, data);
 
         if (s->flags & CUPKEE_STREAM_FL_NOTIFY_DATA && cupkee_buffer_length(buf) > s->rx_buf_size / 2) {
-            cupkee_object_event_post(s->id, CUPKEE_EVENT_DATA);
+            cupkee_object_event_post_data(s->id, CUPKEE_EVENT_DATA, cupkee_buffer_length(buf));
         }
         s->last_push = _cupkee_systicks;
 
@@ -137,17 +137,29 @@ void cupkee_stream_sync(cupkee_stream_t *s, uint32_t systicks)
     if (s->flags & CUPKEE_STREAM_FL_NOTIFY_DATA
         && !cupkee_buffer_is_empty(&s->rx_buf)
         && (systicks - s->last_push) > 20) {
-        cupkee_object_event_post(s->id, CUPKEE_EVENT_DATA);
+        cupkee_object_event_post_data(s->id, CUPKEE_EVENT_DATA, cupkee_buffer_length(&s->rx_buf));
     }
 }
 
+/* Ticks before cupkee_stream_sync has work to do */
+uint32_t cupkee_stream_next(cupkee_stream_t *s, uint32_t systicks)
+{
+    if (s->flags & CUPKEE_STREAM_FL_NOTIFY_DATA
+        && !cupkee_buffer_is_empty(&s->rx_buf)) {
+        uint32_t pass = systicks - s->last_push;
+
+        return pass > 20 ? 0 : 21 - pass;
+    }
+    return CUPKEE_TICKS_INFINITE;
+}
+
 int cupkee_stream_pull(cupkee_stream_t *s, size_t n, void *data)
 {
     if (stream_is_writable(s) && n && data) {
         int cnt = cupkee_buffer_take(&s->tx_buf, n, data);
 
         if (cnt > 0 && cupkee_buffer_is_empty(&s->tx_buf) && s->flags & CUPKEE_STREAM_FL_NOTIFY_DRAIN) {
-            cupkee_object_event_post(s->id, CUPKEE_EVENT_DRAIN);
+            cupkee_object_event_post_data(s->id, CUPKEE_EVENT_DRAIN, cupkee_buffer_space(&s->tx_buf));
         }
 
         return cnt;
@@ -20,146 +20,440 @@
 #include <cupkee.h>
 
 
-static cupkee_timeout_t *timeout_head = NULL;
-static int timeout_next = 0;
-
-static int timeout_clear_by(int (*fn)(cupkee_timeout_t *, int), int x)
+/*
+ * Hierarchical timing wheel
+ *
+ * Level 0 has a slot for each of the next TIMEOUT_WHEEL0_SIZE ticks, each
+ * upper level slot covers a whole round of the level below it, and is
+ * cascaded (requeued) into lower levels when the round begins. Timers far
+ * beyond the wheel span are parked in the last level and cascaded again.
+ */
+#define TIMEOUT_WHEEL0_BITS     CUPKEE_TIMEOUT_WHEEL_BITS
+#define TIMEOUT_WHEEL0_SIZE     (1U << TIMEOUT_WHEEL0_BITS)
+#define TIMEOUT_WHEEL0_MASK     (TIMEOUT_WHEEL0_SIZE - 1)
+#define TIMEOUT_LEVEL_BITS      CUPKEE_TIMEOUT_LEVEL_BITS
+#define TIMEOUT_LEVEL_SIZE      (1U << TIMEOUT_LEVEL_BITS)
+#define TIMEOUT_LEVEL_MASK      (TIMEOUT_LEVEL_SIZE - 1)
+#define TIMEOUT_LEVEL_NUM       (CUPKEE_TIMEOUT_LEVELS - 1)
+#define TIMEOUT_LEVEL_SHIFT(n)  (TIMEOUT_WHEEL0_BITS + (n) * TIMEOUT_LEVEL_BITS)
+#define TIMEOUT_LEVEL_INDEX(t, n) (((t) >> TIMEOUT_LEVEL_SHIFT(n)) & TIMEOUT_LEVEL_MASK)
+#define TIMEOUT_WHEEL_SPAN      (1U << TIMEOUT_LEVEL_SHIFT(TIMEOUT_LEVEL_NUM))
+
+#define TIMEOUT_OF(p)           CUPKEE_CONTAINER_OF(p, cupkee_timeout_t, node)
+#define TIMEOUT_OF_LINK(p)      CUPKEE_CONTAINER_OF(p, cupkee_timeout_t, link)
+
+static list_head_t timeout_wheel0[TIMEOUT_WHEEL0_SIZE];
+static list_head_t timeout_wheel[TIMEOUT_LEVEL_NUM][TIMEOUT_LEVEL_SIZE];
+static list_head_t timeout_used;  // Linked by link
+static list_head_t timeout_free;  // Linked by node
+static uint32_t timeout_ticks;  // Next tick to be processed by the wheel
+static int timeout_count = 0;
+
+/* Timers by slot of id. Allocated when no released one is free, and kept
+ * for reuse: they never move, and register after the peak never allocate.
+ */
+static cupkee_timeout_t **timeout_map;
+static int timeout_map_size;
+static int timeout_map_num;
+
+// Timer in wake up callback, and whether it is cleared by the callback
+static cupkee_timeout_t *timeout_waking = NULL;
+static int timeout_waking_drop = 0;
+static uint32_t timeout_waking_missed = 0;
+
+/*
+ * Tick in [expire, expire + slack] with most trailing zeros, timers with
+ * overlapped windows are rounded to the same tick, and wake up together.
+ */
+static uint32_t timeout_when(cupkee_timeout_t *t)
 {
-    cupkee_timeout_t *prev = NULL, *curr = timeout_head;
-    int n = 0;
+    uint32_t limit = t->expire + t->slack;
+    uint32_t diff = t->expire ^ limit;
+    uint32_t when;
 
-    while (curr) {
-        cupkee_timeout_t *next = curr->next;
+    if (!diff) {
+        return t->expire;
+    }
 
-        if (fn(curr, x)) {
-            if (prev) {
-                prev->next = next;
-            } else {
-                timeout_head = next;
-            }
+    when = limit & ~((1U << (31 - __builtin_clz(diff))) - 1);
+    return (int32_t)(when - t->expire) >= 0 ? when : t->expire;
+}
 
-            curr->handle(1, curr->param); // drop timer
-            cupkee_free(curr);
-            n ++;
-        } else {
-            prev = curr;
-        }
+static void timeout_queue(cupkee_timeout_t *t)
+{
+    uint32_t expire = timeout_when(t);
+    uint32_t delta = expire - timeout_ticks;
+    list_head_t *slot;
+
+    if ((int32_t)delta < 0) {
+        // Overdue, fire at next tick processed
+        expire = timeout_ticks;
+        delta = 0;
+    }
 
-        curr = next;
+    if (delta < TIMEOUT_WHEEL0_SIZE) {
+        slot = &timeout_wheel0[expire & TIMEOUT_WHEEL0_MASK];
+    } else {
+        int n = 0;
+
+        while (n < TIMEOUT_LEVEL_NUM - 1 && delta >= (1U << TIMEOUT_LEVEL_SHIFT(n + 1))) {
+            n++;
+        }
+        if (delta >= TIMEOUT_WHEEL_SPAN) {
+            expire = timeout_ticks + TIMEOUT_WHEEL_SPAN - 1;
+        }
+        slot = &timeout_wheel[n][TIMEOUT_LEVEL_INDEX(expire, n)];
     }
-    return n;
+
+    list_add_tail(&t->node, slot);
 }
 
-static int timeout_with_flag(cupkee_timeout_t *t, int flags)
+static void timeout_release(cupkee_timeout_t *t)
 {
-    return t->flags == flags;
+    list_del(&t->link);
+    timeout_count--;
+
+    t->handle(1, t->param); // drop timer
+    t->handle = NULL;
+
+    // Reused at last, to keep stale ids away from new timers longer
+    list_add_tail(&t->node, &timeout_free);
 }
 
-static int timeout_with_id(cupkee_timeout_t *t, int id)
+static void timeout_drop(cupkee_timeout_t *t)
 {
-    return t->id == id;
+    if (t == timeout_waking) {
+        // Not in wheel now, released after the wake up callback return
+        timeout_waking_drop = 1;
+        return;
+    }
+
+    list_del(&t->node);
+    timeout_release(t);
 }
 
-void cupkee_timeout_setup(void)
+static uint32_t timeout_cascade(int n)
 {
-    timeout_head = NULL;
-    timeout_next = 0;
+    uint32_t index = TIMEOUT_LEVEL_INDEX(timeout_ticks, n);
+    list_head_t *slot = &timeout_wheel[n][index];
+    list_head_t head;
+
+    if (!list_is_empty(slot)) {
+        // Move out the whole slot first, timers may be queued back into it
+        __list_add(&head, slot->prev, slot->next);
+        list_head_init(slot);
+
+        while (!list_is_empty(&head)) {
+            cupkee_timeout_t *t = TIMEOUT_OF(head.next);
+
+            list_del(&t->node);
+            timeout_queue(t);
+        }
+    }
+
+    return index;
 }
 
-void cupkee_timeout_sync(uint32_t curr_ticks)
+/* Periods of repeat timer passed by, behind the one due now */
+static uint32_t timeout_missed(cupkee_timeout_t *t, uint32_t curr_ticks)
 {
-    cupkee_timeout_t *prev = NULL, *curr = timeout_head;
+    uint32_t late = curr_ticks - t->expire;
 
-    while (curr) {
-        cupkee_timeout_t *next = curr->next;
+    if ((int32_t)late <= 0 || !t->wait) {
+        return 0;
+    }
+    return late / t->wait;
+}
 
-        if (curr_ticks - curr->from >= curr->wait) {
-            curr->handle(0, curr->param);       // wake up
+static void timeout_expire(list_head_t *slot, uint32_t curr_ticks)
+{
+    list_head_t head;
 
-            if (curr->flags & CUPKEE_FLAG_REPEAT) {
-                curr->from = curr_ticks;
-                prev = curr;
-            } else {
-                curr->handle(1, curr->param);   // drop
-                if (prev) {
-                    prev->next = next;
-                } else {
-                    // Current timer is header
-                    timeout_head = next;
-                }
-                cupkee_free(curr);
+    if (list_is_empty(slot)) {
+        return;
+    }
+
+    __list_add(&head, slot->prev, slot->next);
+    list_head_init(slot);
+
+    while (!list_is_empty(&head)) {
+        cupkee_timeout_t *t = TIMEOUT_OF(head.next);
+        uint32_t missed = 0;
+
+        list_del(&t->node);
+
+        if (t->flags & CUPKEE_FLAG_REPEAT) {
+            if (!(t->flags & CUPKEE_TIMEOUT_CATCHUP)) {
+                missed = timeout_missed(t, curr_ticks);
             }
+            // Anchored to the original schedule, never drift with latency
+            t->expire += t->wait * (missed + 1);
+        }
+
+        timeout_waking = t;
+        timeout_waking_drop = 0;
+        timeout_waking_missed = (t->flags & CUPKEE_TIMEOUT_SKIP) ? 0 : missed;
+        t->handle(0, t->param);             // wake up
+        timeout_waking = NULL;
+        timeout_waking_missed = 0;
+
+        if ((t->flags & CUPKEE_FLAG_REPEAT) && !timeout_waking_drop) {
+            timeout_queue(t);
         } else {
-            prev = curr;
+            timeout_release(t);
+        }
+    }
+}
+
+/* Earliest expire of timers in slot, as ticks after base */
+static uint32_t timeout_slot_next(list_head_t *slot, uint32_t base)
+{
+    list_head_t *pos;
+    uint32_t next = CUPKEE_TICKS_INFINITE;
+
+    list_for_each(pos, slot) {
+        uint32_t delta = timeout_when(TIMEOUT_OF(pos)) - base;
+
+        if ((int32_t)delta < 0) {
+            return 0;
+        }
+        if (delta < next) {
+            next = delta;
         }
-        curr = next;
     }
+
+    return next;
+}
+
+static int timeout_clear_by(int (*fn)(cupkee_timeout_t *, int), int x)
+{
+    list_head_t *pos = timeout_used.next;
+    int n = 0;
+
+    while (pos != &timeout_used) {
+        cupkee_timeout_t *t = TIMEOUT_OF_LINK(pos);
+
+        pos = pos->next;
+        if (fn(t, x)) {
+            timeout_drop(t);
+            n ++;
+        }
+    }
+    return n;
+}
+
+static int timeout_with_flag(cupkee_timeout_t *t, int flags)
+{
+    // Timers are cleared by type, whatever their missed period policy
+    return (t->flags & ~CUPKEE_TIMEOUT_POLICY) == (flags & ~CUPKEE_TIMEOUT_POLICY);
+}
+
+static int timeout_with_any(cupkee_timeout_t *t, int x)
+{
+    (void) t;
+    (void) x;
+    return 1;
+}
+
+static int timeout_map_grow(int slot)
+{
+    int size = timeout_map_size ? timeout_map_size : CUPKEE_TIMEOUT_NUM_DEF;
+    cupkee_timeout_t **map;
+
+    while (size <= slot) {
+        size *= 2;
+    }
+    if (size > CUPKEE_TIMEOUT_MAX) {
+        size = CUPKEE_TIMEOUT_MAX;
+    }
+
+    map = cupkee_realloc(timeout_map, size * sizeof(cupkee_timeout_t *));
+    if (!map) {
+        return -1;
+    }
+
+    timeout_map = map;
+    timeout_map_size = size;
+
+    return 0;
 }
 
-cupkee_timeout_t *cupkee_timeout_register(uint32_t wait, int flags, cupkee_timeout_handle_t handle, void *param)
+static cupkee_timeout_t *timeout_alloc(void)
 {
+    int slot = timeout_map_num;
     cupkee_timeout_t *t;
 
-    if (!handle) {
+    if (!list_is_empty(&timeout_free)) {
+        t = TIMEOUT_OF(timeout_free.next);
+        list_del(&t->node);
+        return t;
+    }
+
+    if (slot >= CUPKEE_TIMEOUT_MAX) {
+        return NULL;
+    }
+    if (slot >= timeout_map_size && timeout_map_grow(slot)) {
         return NULL;
     }
 
     t = cupkee_malloc(sizeof(cupkee_timeout_t));
     if (t) {
-        t->handle = handle;
-        t->param  = param;
-        t->id     = timeout_next++;
-        t->wait   = wait;
-        t->from   = _cupkee_systicks;
-        t->flags  = flags;
+        t->id = slot;   // generation 0, never handed out
+        timeout_map[slot] = t;
+        timeout_map_num++;
+    }
+    return t;
+}
+
+void cupkee_timeout_setup(void)
+{
+    int i, n;
 
-        t->next = timeout_head;
-        timeout_head = t;
+    for (i = 0; i < (int)TIMEOUT_WHEEL0_SIZE; i++) {
+        list_head_init(&timeout_wheel0[i]);
     }
+    for (n = 0; n < TIMEOUT_LEVEL_NUM; n++) {
+        for (i = 0; i < (int)TIMEOUT_LEVEL_SIZE; i++) {
+            list_head_init(&timeout_wheel[n][i]);
+        }
+    }
+    list_head_init(&timeout_used);
+    list_head_init(&timeout_free);
 
-    return t;
+    // Allocated on first register
+    timeout_map = NULL;
+    timeout_map_size = 0;
+    timeout_map_num = 0;
+
+    timeout_ticks = _cupkee_systicks;
+    timeout_count = 0;
+    timeout_waking = NULL;
 }
 
-void cupkee_timeout_unregister(cupkee_timeout_t *t)
+void cupkee_timeout_sync(uint32_t curr_ticks)
 {
-    cupkee_timeout_t *prev = NULL, *curr = timeout_head;
+    // Catch up all ticks passed, systick events may be coalesced or slept over
+    while ((int32_t)(curr_ticks - timeout_ticks) >= 0) {
+        uint32_t index = timeout_ticks & TIMEOUT_WHEEL0_MASK;
+        list_head_t *slot = &timeout_wheel0[index];
+
+        if (!timeout_count) {
+            timeout_ticks = curr_ticks + 1;
+            break;
+        }
 
-    while (curr) {
-        if (curr == t) {
-            if (prev) {
-                prev->next = curr->next;
-            } else {
-                timeout_head = curr->next;
-            }
+        if (!index) {
+            int n;
+            for (n = 0; n < TIMEOUT_LEVEL_NUM && !timeout_cascade(n); n++)
+                ;
+        }
 
-            curr->handle(1, curr->param); // drop timer
-            cupkee_free(curr);
+        // Tick is done before callbacks, new timers never land in this slot
+        timeout_ticks++;
+        timeout_expire(slot, curr_ticks);
+    }
+}
+
+/* Periods missed by the repeat timeout in wake up callback */
+uint32_t cupkee_timeout_missed(void)
+{
+    return timeout_waking_missed;
+}
+
+/* Ticks before the nearest timeout wake up, CUPKEE_TICKS_INFINITE if none */
+uint32_t cupkee_timeout_next(uint32_t curr_ticks)
+{
+    uint32_t base = timeout_ticks;
+    uint32_t next = CUPKEE_TICKS_INFINITE;
+    uint32_t d;
+    int n;
+
+    if (!timeout_count) {
+        return CUPKEE_TICKS_INFINITE;
+    }
 
-            return;
+    for (d = 0; d < TIMEOUT_WHEEL0_SIZE; d++) {
+        if (!list_is_empty(&timeout_wheel0[(base + d) & TIMEOUT_WHEEL0_MASK])) {
+            next = d;
+            break;
         }
+    }
+
+    // First slot to be cascaded in each level holds the earliest timers of it
+    for (n = 0; n < TIMEOUT_LEVEL_NUM; n++) {
+        uint32_t shift = TIMEOUT_LEVEL_SHIFT(n);
+        uint32_t round = (base + (1U << shift) - 1) >> shift;
+
+        for (d = 0; d < TIMEOUT_LEVEL_SIZE; d++) {
+            list_head_t *slot = &timeout_wheel[n][(round + d) & TIMEOUT_LEVEL_MASK];
 
-        prev = curr;
-        curr = curr->next;
+            if (!list_is_empty(slot)) {
+                uint32_t delta = timeout_slot_next(slot, base);
+                if (delta < next) {
+                    next = delta;
+                }
+                break;
+            }
+        }
+    }
+
+    if (next == CUPKEE_TICKS_INFINITE) {
+        return next;
     }
+
+    next += base;
+    return (int32_t)(next - curr_ticks) > 0 ? next - curr_ticks : 0;
 }
 
-int cupkee_timeout_clear_all(void)
+cupkee_timeout_t *cupkee_timeout_register_ext(uint32_t wait, uint32_t slack, int flags, cupkee_timeout_handle_t handle, void *param)
 {
-    cupkee_timeout_t *curr = timeout_head;
-    int n = 0;
+    cupkee_timeout_t *t;
+    uint32_t gen;
 
-    timeout_head = NULL;
-    while (curr) {
-        cupkee_timeout_t *next = curr->next;
+    if (!handle || !(t = timeout_alloc())) {
+        return NULL;
+    }
 
-        curr->handle(1, curr->param); // drop timer
-        cupkee_free(curr);
+    if (!timeout_count) {
+        // Wheel is empty, rebase it to current ticks
+        timeout_ticks = _cupkee_systicks;
+    }
 
-        curr = next;
-        n ++;
+    // Wake up late by slack is not a missed period
+    if ((flags & CUPKEE_FLAG_REPEAT) && slack >= wait) {
+        slack = wait ? wait - 1 : 0;
     }
 
-    return n;
+    gen = ((t->id >> CUPKEE_TIMEOUT_ID_SHIFT) + 1) & CUPKEE_TIMEOUT_GEN_MASK;
+    if (!gen) {
+        gen = 1;
+    }
+
+    t->handle = handle;
+    t->param  = param;
+    t->id     = (gen << CUPKEE_TIMEOUT_ID_SHIFT) | cupkee_timeout_slot(t->id);
+    t->wait   = wait;
+    t->slack  = slack;
+    t->expire = _cupkee_systicks + wait;
+    t->flags  = flags;
+
+    list_add_tail(&t->link, &timeout_used);
+    timeout_queue(t);
+    timeout_count++;
+
+    return t;
+}
+
+void cupkee_timeout_unregister(cupkee_timeout_t *t)
+{
+    if (t && t->handle) {
+        timeout_drop(t);
+    }
+}
+
+int cupkee_timeout_clear_all(void)
+{
+    return timeout_clear_by(timeout_with_any, 0);
 }
 
 int cupkee_timeout_clear_with_flags(uint32_t flags)
@@ -169,7 +463,20 @@ int cupkee_timeout_clear_with_flags(uint32_t flags)
 
 int cupkee_timeout_clear_with_id(uint32_t id)
 {
-    return timeout_clear_by(timeout_with_id, id);
+    uint32_t slot = cupkee_timeout_slot(id);
+    cupkee_timeout_t *t;
+
+    if (slot >= (uint32_t)timeout_map_num) {
+        return 0;
+    }
+
+    // Stale id of a recycled slot has an old generation
+    t = timeout_map[slot];
+    if (t->handle && t->id == (int)id) {
+        timeout_drop(t);
+        return 1;
+    }
+    return 0;
 }
 
 volatile uint32_t _cupkee_systicks;
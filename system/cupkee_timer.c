@@ -60,11 +60,11 @@ static void timer_event_handle(void *entry, uint8_t code)
     }
 }
 
-static int timer_get_prop (void *entry, const char *k, intptr_t *p)
+static int timer_duration_get(void *entry, intptr_t *p)
 {
     cupkee_timer_t *t = entry;
 
-    if (t && !strcmp(k, "duration")) {
+    if (t) {
         *p = cupkee_timer_duration(t);
         return CUPKEE_OBJECT_ELEM_INT;
     } else {
@@ -82,13 +82,19 @@ static void timer_destroy(void *entry)
     }
 }
 
+// Sorted by name
+static const cupkee_prop_t timer_props[] = {
+    {"duration", timer_duration_get, NULL},
+};
+
 static const cupkee_desc_t timer_desc = {
     .name         = "Timer",
 
+    .props        = timer_props,
+    .prop_num     = sizeof(timer_props) / sizeof(cupkee_prop_t),
+
     .destroy      = timer_destroy,
     .event_handle = timer_event_handle,
-
-    .prop_get     = timer_get_prop,
 };
 
 int cupkee_timer_setup(void)
@@ -172,7 +178,7 @@ int cupkee_timer_stop(cupkee_timer_t *timer)
     if (0 == hw_timer_stop(timer->inst)) {
         cupkee_object_event_post(CUPKEE_ENTRY_ID(timer), CUPKEE_EVENT_STOP);
     } else {
-        cupkee_object_event_post(CUPKEE_ENTRY_ID(timer), CUPKEE_EVENT_ERROR);
+        cupkee_object_event_post_data(CUPKEE_ENTRY_ID(timer), CUPKEE_EVENT_ERROR, -CUPKEE_EHARDWARE);
     }
 
     return 0;
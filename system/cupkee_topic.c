@@ -0,0 +1,102 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include "cupkee.h"
+
+typedef struct topic_sub_t {
+    cupkee_callback_t handler;  // NULL: free slot
+    void             *entry;
+    uint8_t           topic;
+} topic_sub_t;
+
+static topic_sub_t topic_subs[CUPKEE_TOPIC_SUBSCRIBERS];
+
+void cupkee_topic_setup(void)
+{
+    memset(topic_subs, 0, sizeof(topic_subs));
+}
+
+/* Return subscriber id */
+int cupkee_topic_subscribe(int topic, cupkee_callback_t handler, void *entry)
+{
+    int sid;
+
+    if ((unsigned)topic >= CUPKEE_TOPIC_MAX || !handler) {
+        return -CUPKEE_EINVAL;
+    }
+
+    for (sid = 0; sid < CUPKEE_TOPIC_SUBSCRIBERS; sid++) {
+        topic_sub_t *sub = &topic_subs[sid];
+
+        if (!sub->handler) {
+            sub->handler = handler;
+            sub->entry = entry;
+            sub->topic = topic;
+            return sid;
+        }
+    }
+
+    return -CUPKEE_ERESOURCE;
+}
+
+int cupkee_topic_unsubscribe(int sid)
+{
+    topic_sub_t *sub;
+    cupkee_callback_t handler;
+
+    if ((unsigned)sid >= CUPKEE_TOPIC_SUBSCRIBERS || !topic_subs[sid].handler) {
+        return -CUPKEE_EINVAL;
+    }
+
+    sub = &topic_subs[sid];
+    handler = sub->handler;
+    sub->handler = NULL;
+
+    handler(sub->entry, CUPKEE_TOPIC_DROP, 0);
+
+    return CUPKEE_OK;
+}
+
+int cupkee_topic_subscribers(int topic)
+{
+    int sid, n = 0;
+
+    for (sid = 0; sid < CUPKEE_TOPIC_SUBSCRIBERS; sid++) {
+        if (topic_subs[sid].handler && topic_subs[sid].topic == topic) {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+void cupkee_topic_dispatch(uint16_t topic, uint32_t value)
+{
+    int sid;
+
+    // Slot is checked at calling, handler may unsubscribe itself or others
+    for (sid = 0; sid < CUPKEE_TOPIC_SUBSCRIBERS; sid++) {
+        topic_sub_t *sub = &topic_subs[sid];
+
+        if (sub->handler && sub->topic == topic) {
+            sub->handler(sub->entry, topic, value);
+        }
+    }
+}
+
@@ -31,6 +31,9 @@ static int mock_timer_curr_id   = -1;
 static int mock_timer_curr_period = -1;
 static int mock_timer_curr_duration = -1;
 static int mock_timer_curr_state = -1;  // 0: stop, 1: start, -1: noused
+static uint32_t mock_idle_calls = 0;
+static uint32_t mock_idle_ticks = 0;
+static uint32_t mock_cycles = 0;
 
 void hw_mock_init(size_t mem_size)
 {
@@ -38,7 +41,10 @@ void hw_mock_init(size_t mem_size)
         free(mock_memory_base);
     }
 
-    mock_memory_base = malloc(mem_size);
+    // Page aligned, to make the memory layout independent of host heap
+    if (0 != posix_memalign((void **)&mock_memory_base, CUPKEE_PAGE_SIZE, mem_size)) {
+        mock_memory_base = NULL;
+    }
     mock_memory_size = mem_size;
     mock_memory_off = 0;
 }
@@ -121,6 +127,42 @@ void hw_poll(void)
 void hw_halt(void)
 {}
 
+/* Virtual sleep: time runs to max_ticks, then systick wakes the loop */
+void hw_idle(uint32_t max_ticks)
+{
+    mock_idle_calls++;
+    mock_idle_ticks += max_ticks;
+
+    _cupkee_systicks += max_ticks;
+    cupkee_event_post_systick();
+}
+
+uint32_t hw_cycle_count(void)
+{
+    return mock_cycles;
+}
+
+void hw_mock_cycle_set(uint32_t cycles)
+{
+    mock_cycles = cycles;
+}
+
+void hw_mock_idle_reset(void)
+{
+    mock_idle_calls = 0;
+    mock_idle_ticks = 0;
+}
+
+uint32_t hw_mock_idle_calls(void)
+{
+    return mock_idle_calls;
+}
+
+uint32_t hw_mock_idle_ticks(void)
+{
+    return mock_idle_ticks;
+}
+
 void hw_info_get(hw_info_t *info)
 {
     info->ram_base = mock_memory_base;
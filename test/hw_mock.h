@@ -29,6 +29,14 @@ size_t           mock_device_curr_want(void);
 int  hw_mock_device_curr_id(void);
 size_t hw_mock_device_curr_want(void);
 
+/* IDLE */
+void     hw_mock_idle_reset(void);
+uint32_t hw_mock_idle_calls(void);
+uint32_t hw_mock_idle_ticks(void);
+
+/* CYCLE COUNTER */
+void     hw_mock_cycle_set(uint32_t cycles);
+
 /* TIMER */
 int hw_mock_timer_curr_id(void);
 int hw_mock_timer_curr_state(void);
@@ -35,7 +35,10 @@ int main(int argc, const char *argv[])
     test_hello();
 
     test_sys_memory();
+    test_sys_pool();
+    test_sys_defer();
     test_sys_event();
+    test_sys_topic();
 
     test_sys_timeout();
     test_sys_process();
@@ -36,6 +36,9 @@ CU_pSuite test_hello(void);
 
 CU_pSuite test_sys_event(void);
 CU_pSuite test_sys_memory(void);
+CU_pSuite test_sys_pool(void);
+CU_pSuite test_sys_defer(void);
+CU_pSuite test_sys_topic(void);
 CU_pSuite test_sys_timeout(void);
 CU_pSuite test_sys_process(void);
 CU_pSuite test_sys_struct(void);
@@ -0,0 +1,147 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+static int test_setup(void)
+{
+    return TU_pre_init();
+}
+
+static int test_clean(void)
+{
+    return TU_pre_deinit();
+}
+
+static int defer_order[64];
+static int defer_count;
+
+static void defer_record(void *arg)
+{
+    if (defer_count < 64) {
+        defer_order[defer_count] = (intptr_t)arg;
+    }
+    defer_count++;
+}
+
+static void defer_again(void *arg)
+{
+    intptr_t n = (intptr_t)arg;
+
+    defer_count++;
+    if (n > 1) {
+        cupkee_defer(defer_again, (void *)(n - 1));
+    }
+}
+
+static void test_run(void)
+{
+    cupkee_defer_stat_t stat;
+    intptr_t i;
+
+    cupkee_defer_setup();
+    defer_count = 0;
+
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_defer(NULL, NULL));
+    CU_ASSERT(0 == cupkee_defer_pending());
+    CU_ASSERT(0 == cupkee_defer_run(8));
+
+    for (i = 0; i < 5; i++) {
+        CU_ASSERT(CUPKEE_OK == cupkee_defer(defer_record, (void *)i));
+    }
+    CU_ASSERT(1 == cupkee_defer_pending());
+
+    // Budget limited, in order
+    CU_ASSERT(3 == cupkee_defer_run(3));
+    CU_ASSERT(defer_count == 3);
+    CU_ASSERT(2 == cupkee_defer_run(8));
+    CU_ASSERT(defer_count == 5);
+    for (i = 0; i < 5; i++) {
+        CU_ASSERT(defer_order[i] == i);
+    }
+    CU_ASSERT(0 == cupkee_defer_pending());
+
+    cupkee_defer_stat(&stat);
+    CU_ASSERT(stat.depth_max == 5 && stat.drops == 0 && stat.runs == 5);
+}
+
+static void test_full(void)
+{
+    cupkee_defer_stat_t stat;
+    int i;
+
+    cupkee_defer_setup();
+    defer_count = 0;
+
+    for (i = 0; i < CUPKEE_DEFER_SIZE; i++) {
+        CU_ASSERT(CUPKEE_OK == cupkee_defer(defer_record, NULL));
+    }
+    CU_ASSERT(-CUPKEE_EOVERFLOW == cupkee_defer(defer_record, NULL));
+    CU_ASSERT(-CUPKEE_EOVERFLOW == cupkee_defer(defer_record, NULL));
+
+    cupkee_defer_stat(&stat);
+    CU_ASSERT(stat.depth_max == CUPKEE_DEFER_SIZE && stat.drops == 2);
+
+    // Space given back
+    CU_ASSERT(1 == cupkee_defer_run(1));
+    CU_ASSERT(CUPKEE_OK == cupkee_defer(defer_record, NULL));
+    CU_ASSERT(CUPKEE_DEFER_SIZE == cupkee_defer_run(CUPKEE_DEFER_SIZE * 2));
+    CU_ASSERT(defer_count == CUPKEE_DEFER_SIZE + 1);
+}
+
+static void test_poll(void)
+{
+    cupkee_defer_setup();
+    cupkee_event_reset();
+    defer_count = 0;
+
+    // Work defer itself is run in next poll
+    CU_ASSERT(CUPKEE_OK == cupkee_defer(defer_again, (void *)(CUPKEE_DEFER_BUDGET * 2)));
+    cupkee_event_poll();
+    CU_ASSERT(defer_count == CUPKEE_DEFER_BUDGET);
+    CU_ASSERT(1 == cupkee_defer_pending());
+    cupkee_event_poll();
+    CU_ASSERT(defer_count == CUPKEE_DEFER_BUDGET * 2);
+    CU_ASSERT(0 == cupkee_defer_pending());
+
+    // No sleep while works pending
+    hw_mock_idle_reset();
+    cupkee_defer(defer_record, NULL);
+    cupkee_idle();
+    CU_ASSERT(0 == hw_mock_idle_calls());
+    cupkee_event_poll();
+    cupkee_event_reset();
+}
+
+CU_pSuite test_sys_defer(void)
+{
+    CU_pSuite suite = CU_add_suite("system defer", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "defer run        ", test_run);
+        CU_add_test(suite, "defer full       ", test_full);
+        CU_add_test(suite, "defer poll       ", test_poll);
+    }
+
+    return suite;
+}
+
@@ -524,6 +524,8 @@ static void test_config(void)
     CU_ASSERT(cupkee_prop_get(dev, "parity",   &n) == CUPKEE_OBJECT_ELEM_STR && (const char *)n == parity_options[0]);
     CU_ASSERT(cupkee_prop_get(dev, "stopbits", &n) == CUPKEE_OBJECT_ELEM_INT && n == 1);
     CU_ASSERT(cupkee_prop_get(dev, "channel",  &n) == CUPKEE_OBJECT_ELEM_OCT);
+    CU_ASSERT(cupkee_prop_get(dev, "isEnabled", &n) == CUPKEE_OBJECT_ELEM_BOOL && n == 0);
+    CU_ASSERT(cupkee_prop_get_sym(dev, "baudrate", &n) == CUPKEE_OBJECT_ELEM_INT && n == 115200);
 
     // update config
     CU_ASSERT(cupkee_prop_set(dev, "baudrate", CUPKEE_OBJECT_ELEM_INT, 9600) > 0);
@@ -19,6 +19,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "test.h"
 #include <cupkee.h>
@@ -67,6 +70,358 @@ static void test_post_take(void)
     cupkee_event_reset();
 }
 
+static void test_post_full(void)
+{
+    int i;
+    cupkee_event_t e;
+
+    cupkee_event_setup();
+
+    for (i = 0; i < CUPKEE_EVENTQ_SIZE; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_post(1, i, i), 1);
+    }
+    CU_ASSERT_EQUAL(cupkee_event_post(1, 16, 16), 0);
+
+    for (i = 0; i < CUPKEE_EVENTQ_SIZE; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_take(&e), 1);
+        CU_ASSERT_EQUAL(e.which, i);
+    }
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 0);
+
+    cupkee_event_reset();
+}
+
+static void test_coalesce(void)
+{
+    int i;
+    cupkee_event_t e;
+
+    cupkee_event_setup();
+
+    // Burst of same events cost one entry
+    for (i = 0; i < 100; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_post_systick(), 1);
+        CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, 3), 1);
+        CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DRAIN, 3), 1);
+    }
+    // Not coalesced: other object, other code
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, 4), 1);
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_ERROR, 3), 1);
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_ERROR, 3), 1);
+
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 1);
+    CU_ASSERT(e.type == EVENT_SYSTICK);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_DATA && e.which == 3);
+    // Pending again after taken
+    CU_ASSERT_EQUAL(cupkee_event_post_systick(), 1);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.type == EVENT_SYSTICK);
+
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_DRAIN && e.which == 3);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_DATA && e.which == 4);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_ERROR);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_ERROR);
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 0);
+
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_SYSTICK), 0);
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_OBJECT), 0);
+
+    cupkee_event_reset();
+}
+
+static void test_drops(void)
+{
+    int i;
+    cupkee_event_t e;
+
+    cupkee_event_setup();
+
+    for (i = 0; i < CUPKEE_EVENTQ_SIZE; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_post_pin(i, CUPKEE_EVENT_PIN_RISING), 1);
+    }
+    CU_ASSERT_EQUAL(cupkee_event_post_pin(0, CUPKEE_EVENT_PIN_FALLING), 0);
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, 1), 0);
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, 1), 0);
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_PIN), 1);
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_OBJECT), 2);
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_SYSTICK), 0);
+
+    // Dropped event is not left pending
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 1);
+    CU_ASSERT_EQUAL(cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, 1), 1);
+    for (i = 1; i < CUPKEE_EVENTQ_SIZE; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_take(&e), 1);
+    }
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_DATA && e.which == 1);
+
+    cupkee_event_reset();
+    CU_ASSERT_EQUAL(cupkee_event_drops(EVENT_OBJECT), 0);
+}
+
+static void test_priority(void)
+{
+    int i;
+    cupkee_event_t e;
+
+    cupkee_event_setup();
+
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT_EQUAL(cupkee_event_post_pin(i, CUPKEE_EVENT_PIN_RISING), 1);
+    }
+    cupkee_object_event_post(1, CUPKEE_EVENT_UPDATE);
+    cupkee_object_event_post(2, CUPKEE_EVENT_RESPONSE);
+    cupkee_object_event_post(3, CUPKEE_EVENT_DRAIN);
+
+    // Urgent I/O completion first, in post order
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_RESPONSE && e.which == 2);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.code == CUPKEE_EVENT_DRAIN && e.which == 3);
+
+    CU_ASSERT(cupkee_event_take_prio(EVENT_PRIO_URGENT, &e) == 0);
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT(cupkee_event_take_prio(EVENT_PRIO_NORMAL, &e) == 1 && e.type == EVENT_PIN && e.which == i);
+    }
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.type == EVENT_OBJECT && e.code == CUPKEE_EVENT_UPDATE);
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 0);
+
+    // Full normal queue does not block urgent post
+    for (i = 0; i < CUPKEE_EVENTQ_SIZE; i++) {
+        cupkee_event_post_pin(0, CUPKEE_EVENT_PIN_RISING);
+    }
+    CU_ASSERT_EQUAL(cupkee_event_post_pin(0, CUPKEE_EVENT_PIN_RISING), 0);
+    CU_ASSERT_EQUAL(cupkee_event_post_systick(), 1);
+    CU_ASSERT(cupkee_event_take(&e) == 1 && e.type == EVENT_SYSTICK);
+
+    cupkee_event_reset();
+}
+
+static void test_payload(void)
+{
+    cupkee_event_t e;
+
+    cupkee_event_setup();
+
+    CU_ASSERT(1 == cupkee_event_post_ext(EVENT_PRIO_NORMAL, EVENT_OBJECT, CUPKEE_EVENT_USER, 1, 0x12345678));
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT(e.data == 0x12345678 && cupkee_event_data() == 0x12345678);
+
+    // Pin edge carry its systicks
+    _cupkee_systicks = 77;
+    cupkee_event_post_pin(3, 1);
+    _cupkee_systicks = 80;
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT(e.type == EVENT_PIN && e.which == 3 && e.data == 77);
+
+    // Coalesced event carry the latest payload
+    cupkee_object_event_post_data(2, CUPKEE_EVENT_DATA, 10);
+    cupkee_object_event_post_data(2, CUPKEE_EVENT_DATA, 20);
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT(e.code == CUPKEE_EVENT_DATA && e.data == 20 && cupkee_event_data() == 20);
+    CU_ASSERT(0 == cupkee_event_take(&e));
+
+    _cupkee_systicks = 5;
+    cupkee_event_post_systick();
+    _cupkee_systicks = 6;
+    cupkee_event_post_systick();
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT(e.type == EVENT_SYSTICK && e.data == 6);
+
+    // Error code
+    cupkee_object_event_post_data(2, CUPKEE_EVENT_ERROR, -CUPKEE_EHARDWARE);
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT((int)e.data == -CUPKEE_EHARDWARE);
+
+    _cupkee_systicks = 0;
+    cupkee_event_reset();
+}
+
+#if CUPKEE_EVENT_PROFILE
+static void profile_timeout_handle(int drop, void *param)
+{
+    (void) param;
+
+    if (!drop) {
+        hw_mock_cycle_set(300 + 1000);
+    }
+}
+
+static void test_profile(void)
+{
+    const cupkee_profile_hist_t *h;
+
+    cupkee_event_setup();
+    cupkee_profile_reset();
+
+    CU_ASSERT(NULL != (h = cupkee_profile_hist(CUPKEE_PROFILE_TYPE, EVENT_SYSTICK)));
+    CU_ASSERT(NULL != cupkee_profile_hist(CUPKEE_PROFILE_TAG, CUPKEE_OBJECT_TAG_MAX - 1));
+    CU_ASSERT(NULL == cupkee_profile_hist(CUPKEE_PROFILE_TYPE, EVENT_TYPE_MAX));
+    CU_ASSERT(NULL == cupkee_profile_hist(CUPKEE_PROFILE_TAG, CUPKEE_OBJECT_TAG_MAX));
+
+    // Wait 200 cycles in queue, run 1000 cycles in handler
+    _cupkee_systicks = 0;
+    CU_ASSERT_FATAL(cupkee_timeout_register(1, 0, profile_timeout_handle, NULL) != NULL);
+    hw_mock_cycle_set(100);
+    _cupkee_systicks = 1;
+    cupkee_event_post_systick();
+    hw_mock_cycle_set(300);
+    cupkee_event_poll();
+
+    CU_ASSERT(h->wait[8] == 1);     // [128, 256)
+    CU_ASSERT(h->run[10] == 1);     // [512, 1024)
+
+    // Nothing to do in handler
+    cupkee_event_post_systick();
+    cupkee_event_poll();
+    CU_ASSERT(h->wait[0] == 1);
+    CU_ASSERT(h->run[0] == 1);
+
+    // Overflow to the last bucket
+    hw_mock_cycle_set(0);
+    cupkee_event_post_systick();
+    hw_mock_cycle_set(0x80000000);
+    cupkee_event_poll();
+    CU_ASSERT(h->wait[CUPKEE_EVENT_PROFILE_BUCKETS - 1] == 1);
+
+    cupkee_profile_reset();
+    CU_ASSERT(h->wait[8] == 0 && h->run[10] == 0);
+
+    hw_mock_cycle_set(0);
+    cupkee_event_reset();
+}
+#endif
+
+#define PRODUCER_NUM    2
+#define PRODUCER_POSTS  200000
+
+static void *producer_run(void *arg)
+{
+    uint8_t id = (uint8_t)(intptr_t)arg;
+    int i;
+
+    for (i = 0; i < PRODUCER_POSTS; i++) {
+        while (!cupkee_event_post(EVENT_PIN, id, (uint16_t)i)) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    pthread_t producers[PRODUCER_NUM];
+    uint16_t expect[PRODUCER_NUM];
+    int total = 0, disorder = 0;
+    struct timespec t0, t1;
+    double sec;
+    cupkee_event_t e;
+    int i;
+
+    cupkee_event_setup();
+    memset(expect, 0, sizeof(expect));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < PRODUCER_NUM; i++) {
+        CU_ASSERT_FATAL(pthread_create(&producers[i], NULL, producer_run, (void *)(intptr_t)i) == 0);
+    }
+
+    while (total < PRODUCER_NUM * PRODUCER_POSTS) {
+        if (!cupkee_event_take(&e)) {
+            sched_yield();
+            continue;
+        }
+        if (e.code >= PRODUCER_NUM || e.which != expect[e.code]) {
+            disorder++;
+        } else {
+            expect[e.code]++;
+        }
+        total++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    for (i = 0; i < PRODUCER_NUM; i++) {
+        pthread_join(producers[i], NULL);
+    }
+
+    CU_ASSERT_EQUAL(disorder, 0);
+    CU_ASSERT_EQUAL(cupkee_event_take(&e), 0);
+
+#ifdef CUPKEE_TEST_BENCH
+    // Host benchmark, built by: make test BENCH=1
+    sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("\n    %d events in %.3fs, %.0f ops/s ", total, sec, total / sec);
+#else
+    (void) sec;
+#endif
+
+    cupkee_event_reset();
+}
+
+#define COALESCE_POSTS  100000
+
+static uint32_t coalesce_posted[CUPKEE_EVENT_COALESCE_IDS];
+static int coalesce_done;
+
+static void *coalesce_run(void *arg)
+{
+    int i;
+
+    (void) arg;
+
+    // Producers share every slot, and together overflow the queue
+    for (i = 0; i < COALESCE_POSTS; i++) {
+        uint16_t which = i % CUPKEE_EVENT_COALESCE_IDS;
+
+        __atomic_fetch_add(&coalesce_posted[which], 1, __ATOMIC_SEQ_CST);
+        while (!cupkee_event_post(EVENT_OBJECT, CUPKEE_EVENT_DATA, which)) {
+            sched_yield();
+        }
+    }
+    __atomic_fetch_add(&coalesce_done, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+static void test_concurrent_coalesce(void)
+{
+    pthread_t producers[PRODUCER_NUM];
+    uint32_t seen[CUPKEE_EVENT_COALESCE_IDS];
+    cupkee_event_t e;
+    int i, stale = 0;
+
+    cupkee_event_setup();
+    memset(coalesce_posted, 0, sizeof(coalesce_posted));
+    memset(seen, 0, sizeof(seen));
+    coalesce_done = 0;
+
+    for (i = 0; i < PRODUCER_NUM; i++) {
+        CU_ASSERT_FATAL(pthread_create(&producers[i], NULL, coalesce_run, NULL) == 0);
+    }
+
+    // Every successful post is followed by a take of its slot
+    for (;;) {
+        if (cupkee_event_take(&e)) {
+            seen[e.which] = __atomic_load_n(&coalesce_posted[e.which], __ATOMIC_SEQ_CST);
+        } else
+        if (__atomic_load_n(&coalesce_done, __ATOMIC_SEQ_CST) == PRODUCER_NUM) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+
+    for (i = 0; i < PRODUCER_NUM; i++) {
+        pthread_join(producers[i], NULL);
+    }
+
+    for (i = 0; i < CUPKEE_EVENT_COALESCE_IDS; i++) {
+        if (seen[i] != coalesce_posted[i]) {
+            stale++;
+        }
+    }
+    CU_ASSERT_EQUAL(stale, 0);
+
+    cupkee_event_reset();
+}
+
 #if 0
 static uint8_t emitter1_storage;
 static uint8_t emitter2_storage;
@@ -149,6 +504,16 @@ CU_pSuite test_sys_event(void)
 
     if (suite) {
         CU_add_test(suite, "post & take      ", test_post_take);
+        CU_add_test(suite, "post full        ", test_post_full);
+        CU_add_test(suite, "coalesce         ", test_coalesce);
+        CU_add_test(suite, "drops            ", test_drops);
+        CU_add_test(suite, "priority         ", test_priority);
+        CU_add_test(suite, "payload          ", test_payload);
+#if CUPKEE_EVENT_PROFILE
+        CU_add_test(suite, "profile          ", test_profile);
+#endif
+        CU_add_test(suite, "concurrent       ", test_concurrent);
+        CU_add_test(suite, "concurrent merge ", test_concurrent_coalesce);
 //        CU_add_test(suite, "emitter          ", test_emitter);
 //        CU_add_test(suite, "emitter emit     ", test_emitter_emit);
     }
@@ -18,7 +18,9 @@
  **/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "test.h"
 #include <cupkee.h>
@@ -33,6 +35,17 @@ static int test_clean(void)
     return 0;
 }
 
+static int test_free_page_total(void)
+{
+    int order, total = 0;
+
+    for (order = 0; order < CUPKEE_PAGE_ORDERR_MAX; order++) {
+        total += cupkee_free_pages(order) << order;
+    }
+
+    return total;
+}
+
 static void test_memory_init(void)
 {
     hw_mock_init(32 * 1024);
@@ -158,6 +171,7 @@ static void test_memory_alloc(void)
     for (i = 0; i < 480; i++) {
         cupkee_free(mem[i]);
     }
+    CU_ASSERT(1 == cupkee_memory_trim());
     CU_ASSERT(1 == cupkee_free_pages(0));
     CU_ASSERT(1 == cupkee_free_pages(1));
     CU_ASSERT(1 == cupkee_free_pages(2));
@@ -174,6 +188,7 @@ static void test_memory_alloc(void)
     for (i = 0; i < 240; i++) {
         cupkee_free(mem[i]);
     }
+    CU_ASSERT(1 == cupkee_memory_trim());
     CU_ASSERT(1 == cupkee_free_pages(0));
     CU_ASSERT(1 == cupkee_free_pages(1));
     CU_ASSERT(1 == cupkee_free_pages(2));
@@ -190,6 +205,7 @@ static void test_memory_alloc(void)
     for (i = 0; i < 120; i++) {
         cupkee_free(mem[i]);
     }
+    CU_ASSERT(1 == cupkee_memory_trim());
     CU_ASSERT(1 == cupkee_free_pages(0));
     CU_ASSERT(1 == cupkee_free_pages(1));
     CU_ASSERT(1 == cupkee_free_pages(2));
@@ -206,6 +222,7 @@ static void test_memory_alloc(void)
     for (i = 0; i < 60; i++) {
         cupkee_free(mem[i]);
     }
+    CU_ASSERT(1 == cupkee_memory_trim());
     CU_ASSERT(1 == cupkee_free_pages(0));
     CU_ASSERT(1 == cupkee_free_pages(1));
     CU_ASSERT(1 == cupkee_free_pages(2));
@@ -281,6 +298,579 @@ static void test_memory_alloc(void)
     hw_mock_deinit();
 }
 
+static void test_memory_extend(void)
+{
+    int i, n, z1, z2, pages;
+    size_t ext_size = 8 * 1024 + 512;
+    uint8_t *ext1 = malloc(ext_size);
+    uint8_t *ext2 = malloc(ext_size);
+    cupkee_page_t *page[9];
+    void *mem;
+
+    CU_ASSERT_FATAL(ext1 && ext2);
+
+    hw_mock_init(8 * 1024);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    CU_ASSERT(0 > cupkee_memory_extend(0, ext_size));
+    CU_ASSERT(0 > cupkee_memory_extend((intptr_t)ext1, 256));
+
+    // Zone id is returned
+    CU_ASSERT(1 == (z1 = cupkee_memory_extend((intptr_t)ext1, ext_size)));
+    CU_ASSERT(0 > cupkee_memory_extend((intptr_t)ext1 + 1024, 4096));
+    CU_ASSERT(2 == (z2 = cupkee_memory_extend((intptr_t)ext2, ext_size)));
+    CU_ASSERT(pages + 14 <= test_free_page_total());
+
+    // Pointers of every zone are resolved
+    page[0] = cupkee_page_alloc_prefer(0, z2);
+    CU_ASSERT_FATAL(NULL != page[0]);
+    mem = cupkee_page_memory(page[0]);
+    CU_ASSERT((uint8_t *)mem >= ext2 && (uint8_t *)mem < ext2 + ext_size);
+    CU_ASSERT(page[0] == cupkee_memory_page(mem));
+    CU_ASSERT(page[0] == cupkee_memory_page((uint8_t *)mem + CUPKEE_PAGE_SIZE - 1));
+
+    page[1] = cupkee_page_alloc_prefer(0, z1);
+    CU_ASSERT_FATAL(NULL != page[1]);
+    mem = cupkee_page_memory(page[1]);
+    CU_ASSERT((uint8_t *)mem >= ext1 && (uint8_t *)mem < ext1 + ext_size);
+    CU_ASSERT(page[1] == cupkee_memory_page(mem));
+
+    page[2] = cupkee_page_alloc(0);
+    CU_ASSERT_FATAL(NULL != page[2]);
+    CU_ASSERT(page[2] == cupkee_memory_page(cupkee_page_memory(page[2])));
+
+    CU_ASSERT(NULL == cupkee_memory_page(&z1));
+
+    for (i = 0; i < 3; i++) {
+        cupkee_page_free(page[i]);
+    }
+
+    // Fall back to other zones, when the preferred one is exhausted
+    for (i = 0, n = 0; i < 9; i++) {
+        CU_ASSERT_FATAL(NULL != (page[i] = cupkee_page_alloc_prefer(0, z1)));
+        mem = cupkee_page_memory(page[i]);
+        if ((uint8_t *)mem >= ext1 && (uint8_t *)mem < ext1 + ext_size) {
+            CU_ASSERT(n++ == i);
+        }
+    }
+    CU_ASSERT(n >= 7 && n < 9);
+    for (i = 0; i < 9; i++) {
+        cupkee_page_free(page[i]);
+    }
+
+    // Blocks from extended zone
+    for (i = 0; i < 8; i++) {
+        cupkee_free(cupkee_page_memory(cupkee_page_alloc_prefer(0, z1)));
+    }
+    CU_ASSERT(pages + 14 <= test_free_page_total());
+
+    hw_mock_deinit();
+    free(ext1);
+    free(ext2);
+}
+
+static void test_memory_info(void)
+{
+    int i;
+    void *mem[4];
+    cupkee_memory_info_t info;
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    CU_ASSERT(0 > cupkee_memory_info(NULL));
+
+    CU_ASSERT(0 == cupkee_memory_info(&info));
+    CU_ASSERT(info.page_total == test_free_page_total());
+    CU_ASSERT(info.page_free == info.page_total);
+    CU_ASSERT(info.page_peak == 0);
+    CU_ASSERT(info.free_order_max == 3);
+    CU_ASSERT(info.slab_pages == 0 && info.slab_used == 0);
+    CU_ASSERT(info.alloc_fail == 0);
+
+    CU_ASSERT_FATAL(NULL != (mem[0] = cupkee_malloc(8 * CUPKEE_PAGE_SIZE)));
+    CU_ASSERT_FATAL(NULL != (mem[1] = cupkee_malloc(32)));
+    CU_ASSERT_FATAL(NULL != (mem[2] = cupkee_malloc(32)));
+    CU_ASSERT_FATAL(NULL != (mem[3] = cupkee_malloc(100)));
+    CU_ASSERT(NULL == cupkee_malloc(8 * CUPKEE_PAGE_SIZE));
+
+    CU_ASSERT(0 == cupkee_memory_info(&info));
+    CU_ASSERT(info.page_free == info.page_total - 10);
+    CU_ASSERT(info.page_free == test_free_page_total());
+    CU_ASSERT(info.page_peak == 10);
+    CU_ASSERT(info.free_order_max == 2);
+    CU_ASSERT(info.slab_pages == 2);
+    CU_ASSERT(info.slab_used == 32 + 32 + 128);
+    CU_ASSERT(info.alloc_fail == 1);
+
+    for (i = 0; i < 4; i++) {
+        cupkee_free(mem[i]);
+    }
+    cupkee_memory_trim();
+
+    CU_ASSERT(0 == cupkee_memory_info(&info));
+    CU_ASSERT(info.page_free == info.page_total);
+    CU_ASSERT(info.page_peak == 10);
+    CU_ASSERT(info.free_order_max == 3);
+    CU_ASSERT(info.slab_pages == 0 && info.slab_used == 0);
+
+    hw_mock_deinit();
+}
+
+static void test_memory_realloc(void)
+{
+    int i, pages;
+    uint8_t *p, *q, *r;
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    // Block in slab
+    CU_ASSERT_FATAL(NULL != (p = cupkee_realloc(NULL, 20)));
+    for (i = 0; i < 20; i++) {
+        p[i] = i;
+    }
+    CU_ASSERT(p == cupkee_realloc(p, 24));
+    CU_ASSERT(p == cupkee_realloc(p, 10));
+    CU_ASSERT_FATAL(NULL != (q = cupkee_realloc(p, 100)));
+    CU_ASSERT(q != p);
+    for (i = 0; i < 20 && q[i] == i; i++)
+        ;
+    CU_ASSERT(i == 20);
+
+    // Slab block to pages
+    CU_ASSERT_FATAL(NULL != (p = cupkee_realloc(q, 1000)));
+    for (i = 0; i < 20 && p[i] == i; i++)
+        ;
+    CU_ASSERT(i == 20);
+    cupkee_free(p);
+    cupkee_memory_trim();
+    CU_ASSERT(pages == test_free_page_total());
+
+    // Shrink in place, tail pages back to free lists
+    CU_ASSERT_FATAL(NULL != (p = cupkee_malloc(4 * CUPKEE_PAGE_SIZE)));
+    for (i = 0; i < 16; i++) {
+        p[i] = i;
+    }
+    CU_ASSERT(p == cupkee_realloc(p, CUPKEE_PAGE_SIZE + 1));
+    CU_ASSERT(pages - 2 == test_free_page_total());
+    CU_ASSERT(p == cupkee_realloc(p, 16));
+    CU_ASSERT(pages - 1 == test_free_page_total());
+
+    // Grow in place, while buddies are free
+    CU_ASSERT(p == cupkee_realloc(p, 2 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT(p == cupkee_realloc(p, 4 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT(pages - 4 == test_free_page_total());
+    for (i = 0; i < 16 && p[i] == i; i++)
+        ;
+    CU_ASSERT(i == 16);
+
+    // Buddy is used, block should be moved
+    CU_ASSERT(p == cupkee_realloc(p, 2 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT_FATAL(NULL != (q = cupkee_malloc(2 * CUPKEE_PAGE_SIZE)));
+    CU_ASSERT(q == p + 2 * CUPKEE_PAGE_SIZE);
+    CU_ASSERT_FATAL(NULL != (r = cupkee_realloc(p, 4 * CUPKEE_PAGE_SIZE)));
+    CU_ASSERT(r != p);
+    for (i = 0; i < 16 && r[i] == i; i++)
+        ;
+    CU_ASSERT(i == 16);
+    CU_ASSERT(pages - 6 == test_free_page_total());
+
+    // Failed realloc keeps the old block
+    CU_ASSERT(NULL == cupkee_realloc(r, 256 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT(pages - 6 == test_free_page_total());
+
+    CU_ASSERT(NULL == cupkee_realloc(r, 0));
+    cupkee_free(q);
+    cupkee_memory_trim();
+    CU_ASSERT(pages == test_free_page_total());
+
+    hw_mock_deinit();
+}
+
+static void test_memory_arena(void)
+{
+    int pages;
+    uint8_t *a, *b, *c;
+    cupkee_arena_t arena;
+    cupkee_arena_mark_t mark;
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    cupkee_arena_init(&arena, 0, CUPKEE_MTAG_NONE);
+    CU_ASSERT(NULL == cupkee_arena_alloc(&arena, 0));
+    CU_ASSERT(pages == test_free_page_total());
+
+    // Objects are packed in one page
+    CU_ASSERT_FATAL(NULL != (a = cupkee_arena_alloc(&arena, 5)));
+    CU_ASSERT_FATAL(NULL != (b = cupkee_arena_alloc(&arena, 100)));
+    CU_ASSERT(b == a + sizeof(intptr_t));
+    CU_ASSERT(((intptr_t)b & (sizeof(intptr_t) - 1)) == 0);
+    CU_ASSERT(pages - 1 == test_free_page_total());
+
+    // Roll back to mark
+    cupkee_arena_mark(&arena, &mark);
+    CU_ASSERT_FATAL(NULL != (c = cupkee_arena_alloc(&arena, CUPKEE_PAGE_SIZE / 2)));
+    CU_ASSERT_FATAL(NULL != (c = cupkee_arena_alloc(&arena, CUPKEE_PAGE_SIZE / 2)));
+    CU_ASSERT(pages - 2 == test_free_page_total());
+    CU_ASSERT_FATAL(NULL != (c = cupkee_arena_alloc(&arena, 3 * CUPKEE_PAGE_SIZE)));
+    CU_ASSERT(pages - 6 == test_free_page_total());
+
+    cupkee_arena_reset_to(&arena, &mark);
+    CU_ASSERT(pages - 1 == test_free_page_total());
+    CU_ASSERT(b + 104 == cupkee_arena_alloc(&arena, 8));
+
+    CU_ASSERT(NULL == cupkee_arena_alloc(&arena, 256 * CUPKEE_PAGE_SIZE));
+
+    cupkee_arena_reset(&arena);
+    CU_ASSERT(pages == test_free_page_total());
+
+    hw_mock_deinit();
+}
+
+static void test_memory_tag(void)
+{
+    int pages;
+    void *a, *b, *c, *d;
+    cupkee_memory_tag_t info;
+    cupkee_arena_t arena;
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    CU_ASSERT(NULL == cupkee_malloc_tagged(16, CUPKEE_MTAG_MAX));
+    CU_ASSERT(0 > cupkee_memory_quota_set(CUPKEE_MTAG_MAX, 0));
+    CU_ASSERT(0 > cupkee_memory_tag_info(-1, &info));
+    CU_ASSERT(!strcmp("sdmp", cupkee_memory_tag_name(CUPKEE_MTAG_SDMP)));
+
+    // Bytes are counted in block size
+    CU_ASSERT_FATAL(NULL != (a = cupkee_malloc_tagged(20, CUPKEE_MTAG_SDMP)));
+    CU_ASSERT_FATAL(NULL != (b = cupkee_malloc_tagged(2000, CUPKEE_MTAG_SDMP)));
+    CU_ASSERT_FATAL(NULL != (c = cupkee_malloc_tagged(20, CUPKEE_MTAG_DEVICE)));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 24 + 2 * CUPKEE_PAGE_SIZE);
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_DEVICE, &info));
+    CU_ASSERT(info.used == 24);
+
+    // Blocks of different tags are not mixed in a page
+    CU_ASSERT(cupkee_memory_page(a) != cupkee_memory_page(c));
+
+    // Quota
+    CU_ASSERT(0 == cupkee_memory_quota_set(CUPKEE_MTAG_SDMP, 3 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT(NULL == cupkee_malloc_tagged(1000, CUPKEE_MTAG_SDMP));
+    CU_ASSERT(NULL == cupkee_realloc(b, 4 * CUPKEE_PAGE_SIZE));
+    CU_ASSERT(NULL != (d = cupkee_malloc_tagged(1000, CUPKEE_MTAG_DEVICE)));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 24 + 2 * CUPKEE_PAGE_SIZE);
+    CU_ASSERT(info.quota == 3 * CUPKEE_PAGE_SIZE);
+    CU_ASSERT(info.fail == 2);
+
+    // Realloc keeps the tag
+    CU_ASSERT(b == cupkee_realloc(b, 100));
+    CU_ASSERT(NULL != (a = cupkee_realloc(a, 1000)));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 2 * CUPKEE_PAGE_SIZE);
+
+    // Arena chunks
+    cupkee_arena_init(&arena, 1, CUPKEE_MTAG_SDMP);
+    CU_ASSERT(NULL == cupkee_arena_alloc(&arena, 8));
+    CU_ASSERT(0 == cupkee_memory_quota_set(CUPKEE_MTAG_SDMP, 0));
+    CU_ASSERT(NULL != cupkee_arena_alloc(&arena, 8));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 4 * CUPKEE_PAGE_SIZE);
+    cupkee_arena_reset(&arena);
+
+    cupkee_free(a);
+    cupkee_free(b);
+    cupkee_free(c);
+    cupkee_free(d);
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 0);
+
+    // Grow right at quota: the old block is not counted with the new one
+    CU_ASSERT_FATAL(NULL != (a = cupkee_malloc_tagged(100, CUPKEE_MTAG_SDMP)));
+    CU_ASSERT(0 == cupkee_memory_quota_set(CUPKEE_MTAG_SDMP, 256));
+    CU_ASSERT(NULL == cupkee_realloc(a, 300));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 128);
+    CU_ASSERT(NULL != (a = cupkee_realloc(a, 256)));
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 256);
+    CU_ASSERT(info.fail == 4);
+    CU_ASSERT(0 == cupkee_memory_quota_set(CUPKEE_MTAG_SDMP, 0));
+    cupkee_free(a);
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_SDMP, &info));
+    CU_ASSERT(info.used == 0);
+    CU_ASSERT(0 == cupkee_memory_tag_info(CUPKEE_MTAG_DEVICE, &info));
+    CU_ASSERT(info.used == 0);
+
+    cupkee_memory_trim();
+    CU_ASSERT(pages == test_free_page_total());
+
+    hw_mock_deinit();
+}
+
+static void test_memory_aligned(void)
+{
+    static const size_t sizes[] = {1, 7, 24, 100, 300, 513, 1024};
+    int i, pages;
+    size_t align;
+    void *p, *q;
+    cupkee_buffer_t buf;
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    CU_ASSERT(NULL == cupkee_malloc_aligned(16, 0));
+    CU_ASSERT(NULL == cupkee_malloc_aligned(16, 24));
+    CU_ASSERT(NULL == cupkee_malloc_aligned(16, CUPKEE_PAGE_SIZE * 2));
+
+    for (align = 1; align <= CUPKEE_PAGE_SIZE; align <<= 1) {
+        for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+            // Two blocks, the second one is not the first block of page
+            p = cupkee_malloc_aligned(sizes[i], align);
+            q = cupkee_malloc_aligned(sizes[i], align);
+
+            CU_ASSERT_FATAL(p && q);
+            CU_ASSERT(0 == ((intptr_t)p & (align - 1)));
+            CU_ASSERT(0 == ((intptr_t)q & (align - 1)));
+
+            memset(p, 0xaa, sizes[i]);
+            memset(q, 0x55, sizes[i]);
+            cupkee_free(p);
+            cupkee_free(q);
+        }
+    }
+
+    // DMA buffer, size is rounded up also
+    CU_ASSERT_FATAL(NULL != (p = cupkee_dma_alloc(40)));
+    CU_ASSERT(0 == ((intptr_t)p & (CUPKEE_DMA_ALIGN - 1)));
+    CU_ASSERT(cupkee_memory_page(p) == cupkee_memory_page((uint8_t *)p + CUPKEE_SIZE_ALIGN(40, CUPKEE_DMA_ALIGN) - 1));
+    cupkee_free(p);
+
+    CU_ASSERT(100 == cupkee_buffer_alloc_aligned(&buf, 100, 64));
+    CU_ASSERT(0 == ((intptr_t)buf.ptr & 63));
+    CU_ASSERT(buf.cap == 100 && buf.len == 0);
+    cupkee_buffer_deinit(&buf);
+
+    cupkee_memory_trim();
+    CU_ASSERT(pages == test_free_page_total());
+
+    hw_mock_deinit();
+}
+
+static int test_stat_class(int n, cupkee_memory_stat_t *stat, size_t size)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (stat[i].block_size >= size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void test_memory_slab(void)
+{
+    int i, n, q, cls, pages;
+    void *mem[64 + 1];
+    cupkee_memory_stat_t stat[16];
+
+    hw_mock_init(16 * 1024 + 1023);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    // Fill two pages with 32Bytes blocks
+    n = CUPKEE_PAGE_SIZE / 32;
+    for (i = 0; i < n * 2; i++) {
+        CU_ASSERT_FATAL(NULL != (mem[i] = cupkee_malloc(32)));
+    }
+    CU_ASSERT(pages - 2 == test_free_page_total());
+
+    cls = cupkee_memory_stat(16, stat);
+    CU_ASSERT_FATAL(0 <= (q = test_stat_class(cls, stat, 32)));
+    CU_ASSERT(32 == stat[q].block_size);
+    CU_ASSERT(2 == stat[q].pages);
+    CU_ASSERT(n * 2 == stat[q].block_num);
+    CU_ASSERT(n * 2 == stat[q].block_used);
+    CU_ASSERT(0 == stat[0].pages && 0 == stat[0].block_used);
+
+    // Free block in the older page, it should be reused before a new page
+    cupkee_free(mem[1]);
+    cupkee_free(mem[3]);
+    CU_ASSERT(NULL != (mem[1] = cupkee_malloc(32)));
+    CU_ASSERT(NULL != (mem[3] = cupkee_malloc(32)));
+    CU_ASSERT(pages - 2 == test_free_page_total());
+
+    CU_ASSERT(cls == cupkee_memory_stat(16, stat));
+    CU_ASSERT(2 == stat[q].pages);
+    CU_ASSERT(n * 2 == stat[q].block_used);
+
+    // Page full again, new page is required now
+    CU_ASSERT(NULL != (mem[n * 2] = cupkee_malloc(32)));
+    CU_ASSERT(pages - 3 == test_free_page_total());
+    cupkee_free(mem[n * 2]);
+
+    // Empty page is kept warm, until trim
+    CU_ASSERT(pages - 3 == test_free_page_total());
+    CU_ASSERT(NULL != (mem[n * 2] = cupkee_malloc(32)));
+    CU_ASSERT(pages - 3 == test_free_page_total());
+    cupkee_free(mem[n * 2]);
+    CU_ASSERT(1 == cupkee_memory_trim());
+    CU_ASSERT(pages - 2 == test_free_page_total());
+    CU_ASSERT(0 == cupkee_memory_trim());
+
+    for (i = 0; i < n * 2; i++) {
+        cupkee_free(mem[i]);
+    }
+    CU_ASSERT(pages - CUPKEE_MBCQ_WARM_PAGES == test_free_page_total());
+    CU_ASSERT(CUPKEE_MBCQ_WARM_PAGES == cupkee_memory_trim());
+    CU_ASSERT(pages == test_free_page_total());
+
+    CU_ASSERT(cls == cupkee_memory_stat(16, stat));
+    CU_ASSERT(0 == stat[q].pages && 0 == stat[q].block_used);
+
+    hw_mock_deinit();
+}
+
+/* Sizes recorded from the allocation trace of a shell session:
+ * streams, timeouts, devices, pin groups, struct configs and buffers. */
+static const uint16_t test_trace_sizes[] = {
+    36, 28, 20, 72, 44, 32, 32, 33, 24, 24,
+    52, 17, 96, 40, 28, 28, 12, 64, 150, 270,
+    300, 44, 36, 20, 20, 80, 120, 200, 252, 504,
+    36, 28, 9, 16, 48, 56, 100, 33, 33, 28,
+};
+
+static void test_memory_fragment(void)
+{
+    int i, n, cls;
+    size_t request = 0, holding = 0, legacy = 0;
+    void *mem[sizeof(test_trace_sizes) / sizeof(test_trace_sizes[0])];
+    cupkee_memory_stat_t stat[16];
+
+    hw_mock_init(32 * 1024);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+
+    n = sizeof(test_trace_sizes) / sizeof(test_trace_sizes[0]);
+    for (i = 0; i < n; i++) {
+        size_t size = test_trace_sizes[i];
+        size_t block = 32;
+
+        CU_ASSERT_FATAL(NULL != (mem[i] = cupkee_malloc(size)));
+
+        // The block size of power of 2 classes from 32 to 256 and whole page
+        while (block < size) {
+            block <<= 1;
+        }
+        legacy  += block > 256 ? CUPKEE_PAGE_SIZE : block;
+        request += size;
+    }
+
+    cls = cupkee_memory_stat(16, stat);
+    for (i = 0; i < cls; i++) {
+        holding += stat[i].block_used * stat[i].block_size;
+    }
+
+    // Internal fragmentation should be less than 1/4
+    CU_ASSERT(holding >= request);
+    CU_ASSERT((holding - request) * 4 < request);
+    CU_ASSERT(holding * 3 < legacy * 2);
+
+    for (i = 0; i < n; i++) {
+        cupkee_free(mem[i]);
+    }
+
+    hw_mock_deinit();
+}
+
+static void test_memory_warm(void)
+{
+    int pages;
+    void *a, *b;
+
+    hw_mock_init(32 * 1024);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+    pages = test_free_page_total();
+
+    // Last block freed, the page is kept warm with its freelist
+    CU_ASSERT_FATAL(NULL != (a = cupkee_malloc(sizeof(cupkee_timeout_t))));
+    cupkee_free(a);
+    CU_ASSERT(pages - 1 == test_free_page_total());
+
+    // and taken again by the next malloc of the class, without a new page
+    CU_ASSERT_FATAL(NULL != (b = cupkee_malloc(sizeof(cupkee_timeout_t))));
+    CU_ASSERT(cupkee_memory_page(a) == cupkee_memory_page(b));
+    CU_ASSERT(pages - 1 == test_free_page_total());
+    cupkee_free(b);
+
+    // Warm pages are given back by trim
+    CU_ASSERT(1 == cupkee_memory_trim());
+    CU_ASSERT(0 == cupkee_memory_trim());
+    CU_ASSERT(pages == test_free_page_total());
+
+    hw_mock_deinit();
+}
+
+#ifdef CUPKEE_TEST_BENCH
+// Host benchmark, built by: make test BENCH=1
+static long test_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void test_memory_bench(void)
+{
+    int i, loops = 100000;
+    long start, cold, warm;
+    void *mem;
+
+    hw_mock_init(32 * 1024);
+
+    CU_ASSERT(0 == cupkee_memory_setup());
+
+    // Page released on every free, as setTimeout / clearTimeout without warm page
+    start = test_clock_ns();
+    for (i = 0; i < loops; i++) {
+        mem = cupkee_malloc(sizeof(cupkee_timeout_t));
+        cupkee_free(mem);
+        cupkee_memory_trim();
+    }
+    cold = test_clock_ns() - start;
+
+    // Page kept warm
+    start = test_clock_ns();
+    for (i = 0; i < loops; i++) {
+        mem = cupkee_malloc(sizeof(cupkee_timeout_t));
+        cupkee_free(mem);
+    }
+    warm = test_clock_ns() - start;
+
+    printf("\n      malloc/free %u bytes: release %ld ns/op, warm %ld ns/op\n",
+           (unsigned)sizeof(cupkee_timeout_t), cold / loops, warm / loops);
+
+    hw_mock_deinit();
+}
+#endif
+
 CU_pSuite test_sys_memory(void)
 {
     CU_pSuite suite = CU_add_suite("system memory", test_setup, test_clean);
@@ -289,6 +879,18 @@ CU_pSuite test_sys_memory(void)
         CU_add_test(suite, "sys memory init  ", test_memory_init);
         CU_add_test(suite, "sys page alloc   ", test_page_alloc);
         CU_add_test(suite, "sys memory alloc ", test_memory_alloc);
+        CU_add_test(suite, "sys memory extend", test_memory_extend);
+        CU_add_test(suite, "sys memory info  ", test_memory_info);
+        CU_add_test(suite, "sys memory realloc", test_memory_realloc);
+        CU_add_test(suite, "sys memory arena ", test_memory_arena);
+        CU_add_test(suite, "sys memory tag   ", test_memory_tag);
+        CU_add_test(suite, "sys memory align ", test_memory_aligned);
+        CU_add_test(suite, "sys memory slab  ", test_memory_slab);
+        CU_add_test(suite, "sys memory frag  ", test_memory_fragment);
+        CU_add_test(suite, "sys memory warm  ", test_memory_warm);
+#ifdef CUPKEE_TEST_BENCH
+        CU_add_test(suite, "sys memory bench ", test_memory_bench);
+#endif
     }
 
     return suite;
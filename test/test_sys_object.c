@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "test.h"
 
@@ -42,6 +43,336 @@ static void test_read(void)
     CU_ASSERT(1);
 }
 
+static int test_events;
+
+static void test_event_handle(void *entry, uint8_t code)
+{
+    (void) entry;
+    (void) code;
+    test_events++;
+}
+
+static const cupkee_desc_t test_desc = {
+    .name = "test",
+    .event_handle = test_event_handle,
+};
+
+static int test_destroys;
+
+static void test_destroy(void *entry)
+{
+    (void) entry;
+    test_destroys++;
+}
+
+static const cupkee_desc_t test_ref_desc = {
+    .name = "ref",
+    .destroy = test_destroy,
+};
+
+static void test_id(void)
+{
+    static int ids[CUPKEE_OBJECT_NUM_MAX + 1];
+    int tag, id, n, i;
+
+    CU_ASSERT_FATAL(0 <= (tag = cupkee_object_register(sizeof(int), &test_desc)));
+
+    // Map grows beyond the default size, up to the limit
+    for (n = 0; n <= CUPKEE_OBJECT_NUM_MAX; n++) {
+        if (0 > (ids[n] = cupkee_create_id(tag))) {
+            break;
+        }
+    }
+    CU_ASSERT(n > CUPKEE_OBJECT_NUM_DEF);
+    CU_ASSERT(ids[n] == -CUPKEE_ERESOURCE);
+    for (i = 0; i < n; i++) {
+        CU_ASSERT(cupkee_id_entry(ids[i], tag) != NULL);
+    }
+
+    // Lowest free slot is reused, with a new generation
+    id = ids[5];
+    CU_ASSERT(0 == cupkee_release(cupkee_id_entry(id, tag)));
+    CU_ASSERT(cupkee_id_entry(id, tag) == NULL);
+    CU_ASSERT(0 <= (ids[5] = cupkee_create_id(tag)));
+    CU_ASSERT(ids[5] != id);
+    CU_ASSERT(CUPKEE_ID_SLOT(ids[5]) == CUPKEE_ID_SLOT(id));
+    CU_ASSERT(cupkee_id_entry(id, tag) == NULL);
+    CU_ASSERT(cupkee_id_tag(id) == CUPKEE_ID_INVALID);
+
+    // Stale id posted in old events never dispatch to the recycled object
+    test_events = 0;
+    cupkee_object_event_dispatch(id, CUPKEE_EVENT_READY);
+    CU_ASSERT(test_events == 0);
+    cupkee_object_event_dispatch(ids[5], CUPKEE_EVENT_READY);
+    CU_ASSERT(test_events == 1);
+
+    for (i = 0; i < n; i++) {
+        CU_ASSERT(0 == cupkee_release(cupkee_id_entry(ids[i], tag)));
+    }
+}
+
+static void test_event_coalesce(void)
+{
+    cupkee_event_t e;
+    int tag, id, old;
+
+    CU_ASSERT_FATAL(0 <= (tag = cupkee_object_register(sizeof(int), &test_desc)));
+    cupkee_event_reset();
+
+    // Recycled slot: the new id carry a generation above the slot bits
+    CU_ASSERT_FATAL(0 <= (old = cupkee_create_id(tag)));
+    CU_ASSERT(0 == cupkee_release(cupkee_id_entry(old, tag)));
+    CU_ASSERT_FATAL(0 <= (id = cupkee_create_id(tag)));
+    CU_ASSERT(CUPKEE_ID_SLOT(id) == CUPKEE_ID_SLOT(old));
+    CU_ASSERT(id >= CUPKEE_EVENT_COALESCE_IDS);
+
+    cupkee_object_event_post_data(id, CUPKEE_EVENT_DATA, 10);
+    cupkee_object_event_post_data(id, CUPKEE_EVENT_DATA, 20);
+    CU_ASSERT(1 == cupkee_event_take(&e) && e.which == id && e.code == CUPKEE_EVENT_DATA);
+    CU_ASSERT(0 == cupkee_event_take(&e));
+
+    CU_ASSERT(0 == cupkee_release(cupkee_id_entry(id, tag)));
+    cupkee_event_reset();
+}
+
+static void test_ref(void)
+{
+    cupkee_object_t *o1, *o2, *o3;
+    int tag;
+
+    CU_ASSERT_FATAL(0 <= (tag = cupkee_object_register(sizeof(int), &test_ref_desc)));
+    test_destroys = 0;
+
+    // Native objects live until the last reference dropped
+    CU_ASSERT_FATAL(NULL != (o1 = cupkee_object_create(tag)));
+    CU_ASSERT(0 == cupkee_object_ref(o1));
+    cupkee_object_unref(o1);
+    CU_ASSERT(test_destroys == 0);
+    cupkee_object_unref(o1);
+    CU_ASSERT(test_destroys == 1);
+
+    // Release drops one holder only
+    CU_ASSERT_FATAL(NULL != (o1 = cupkee_object_create(tag)));
+    CU_ASSERT(0 == cupkee_ref(o1->entry));
+    CU_ASSERT(0 == cupkee_release(o1->entry));
+    CU_ASSERT(test_destroys == 1);
+    CU_ASSERT(0 == cupkee_release(o1->entry));
+    CU_ASSERT(test_destroys == 2);
+
+    // Language objects live while marked, or referenced by native code
+    CU_ASSERT_FATAL(NULL != (o1 = cupkee_object_create(tag)));
+    CU_ASSERT_FATAL(NULL != (o2 = cupkee_object_create(tag)));
+    CU_ASSERT_FATAL(NULL != (o3 = cupkee_object_create(tag)));
+    cupkee_object_lang(o1);
+    cupkee_object_lang(o2);
+    cupkee_object_lang(o3);
+    CU_ASSERT(0 == cupkee_object_ref(o2));
+
+    cupkee_object_keep(o1);
+    CU_ASSERT(2 == cupkee_object_gc());
+    CU_ASSERT(test_destroys == 3);          // o3 released
+
+    // o1 is not marked in next cycle
+    CU_ASSERT(1 == cupkee_object_gc());
+    CU_ASSERT(test_destroys == 4);
+
+    // o2 is handed over to native code
+    CU_ASSERT(0 == cupkee_object_gc());
+    cupkee_object_unref(o2);
+    CU_ASSERT(test_destroys == 5);
+}
+
+static long test_sweep_ns(int tag, int live)
+{
+    static cupkee_object_t *objs[1024];
+    struct timespec t0, t1;
+    long ns = 0;
+    int i, round;
+
+    for (i = 0; i < live; i++) {
+        CU_ASSERT_FATAL(NULL != (objs[i] = cupkee_object_create(tag)));
+        cupkee_object_lang(objs[i]);
+    }
+
+    for (round = 0; round < 16; round++) {
+        // A few garbages each cycle
+        for (i = 0; i < 8; i++) {
+            cupkee_object_lang(cupkee_object_create(tag));
+        }
+        for (i = 0; i < live; i++) {
+            cupkee_object_keep(objs[i]);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        CU_ASSERT(8 == cupkee_object_gc());
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns += (t1.tv_sec - t0.tv_sec) * 1000000000L + (t1.tv_nsec - t0.tv_nsec);
+    }
+
+    // Drop all
+    CU_ASSERT(live == cupkee_object_gc());
+
+    return ns / 16;
+}
+
+static void test_sweep(void)
+{
+    long small, large;
+    int tag;
+
+    // Room for objects
+    hw_mock_init(256 * 1024);
+    cupkee_init(NULL);
+    cupkee_start();
+
+    CU_ASSERT_FATAL(0 <= (tag = cupkee_object_register(sizeof(int), &test_ref_desc)));
+
+    small = test_sweep_ns(tag, 16);
+    large = test_sweep_ns(tag, 1024);
+
+#ifdef CUPKEE_TEST_BENCH
+    // Host benchmark, built by: make test BENCH=1
+    printf("\n    sweep 8 garbages: %ld ns with 16 live, %ld ns with 1024 live ", small, large);
+#else
+    (void) small;
+    (void) large;
+#endif
+
+    TU_pre_init();
+}
+
+static int test_prop_a_get(void *entry, intptr_t *p)
+{
+    *p = *(int *)entry;
+    return CUPKEE_OBJECT_ELEM_INT;
+}
+
+static int test_prop_a_set(void *entry, int t, intptr_t v)
+{
+    if (t != CUPKEE_OBJECT_ELEM_INT) {
+        return -CUPKEE_EINVAL;
+    }
+    *(int *)entry = v;
+    return 1;
+}
+
+static int test_prop_b_get(void *entry, intptr_t *p)
+{
+    (void) entry;
+    *p = (intptr_t)"b";
+    return CUPKEE_OBJECT_ELEM_STR;
+}
+
+static int test_prop_fallback(void *entry, const char *k, intptr_t *p)
+{
+    (void) entry;
+
+    if (!strcmp(k, "dynamic")) {
+        *p = 7;
+        return CUPKEE_OBJECT_ELEM_INT;
+    }
+    return CUPKEE_OBJECT_ELEM_NV;
+}
+
+static const cupkee_prop_t test_props[] = {
+    {"alpha", test_prop_a_get, test_prop_a_set},
+    {"beta",  test_prop_b_get, NULL},
+    {"gamma", NULL,            NULL},
+};
+
+static const cupkee_desc_t test_prop_desc = {
+    .name     = "prop",
+    .props    = test_props,
+    .prop_num = 3,
+    .prop_get = test_prop_fallback,
+};
+
+static const cupkee_prop_t test_props_unsorted[] = {
+    {"beta",  test_prop_b_get, NULL},
+    {"alpha", test_prop_a_get, NULL},
+};
+
+static const cupkee_desc_t test_unsorted_desc = {
+    .name     = "unsorted",
+    .props    = test_props_unsorted,
+    .prop_num = 2,
+};
+
+static const struct {
+    const char *name;
+    void       *fn;
+} test_methods[] = {
+    {"disable", NULL},
+    {"enable",  NULL},
+}, test_methods_unsorted[] = {
+    {"start", NULL},
+    {"start", NULL},
+};
+
+static void test_prop(void)
+{
+    static const char sym[] = "alpha";
+    char key[8], *name;
+    cupkee_object_t *obj;
+    intptr_t v;
+    int tag;
+
+    // Any table of structures begin with name, as method tables of shell meta
+    CU_ASSERT(cupkee_prop_sorted(test_props, 3, sizeof(cupkee_prop_t)));
+    CU_ASSERT(!cupkee_prop_sorted(test_props_unsorted, 2, sizeof(cupkee_prop_t)));
+    CU_ASSERT(cupkee_prop_sorted(test_methods, 2, sizeof(test_methods[0])));
+    CU_ASSERT(!cupkee_prop_sorted(test_methods_unsorted, 2, sizeof(test_methods[0])));
+    CU_ASSERT(cupkee_prop_sorted(NULL, 0, sizeof(cupkee_prop_t)));
+
+    CU_ASSERT(0 > cupkee_object_register(sizeof(int), &test_unsorted_desc));
+    CU_ASSERT_FATAL(0 <= (tag = cupkee_object_register(sizeof(int), &test_prop_desc)));
+    CU_ASSERT_FATAL(NULL != (obj = cupkee_object_create(tag)));
+
+    CU_ASSERT(cupkee_prop_search(test_props, 3, sizeof(cupkee_prop_t), "alpha") == 0);
+    CU_ASSERT(cupkee_prop_search(test_props, 3, sizeof(cupkee_prop_t), "gamma") == 2);
+    CU_ASSERT(cupkee_prop_search(test_props, 3, sizeof(cupkee_prop_t), "delta") < 0);
+
+    CU_ASSERT(cupkee_prop_set(obj->entry, "alpha", CUPKEE_OBJECT_ELEM_INT, 5) == 1);
+    CU_ASSERT(cupkee_prop_get(obj->entry, "alpha", &v) == CUPKEE_OBJECT_ELEM_INT && v == 5);
+    CU_ASSERT(cupkee_prop_get(obj->entry, "beta", &v) == CUPKEE_OBJECT_ELEM_STR && !strcmp((char *)v, "b"));
+
+    // Not in table, or without accessor: go to prop_get of descriptor
+    CU_ASSERT(cupkee_prop_get(obj->entry, "dynamic", &v) == CUPKEE_OBJECT_ELEM_INT && v == 7);
+    CU_ASSERT(cupkee_prop_get(obj->entry, "gamma", &v) == CUPKEE_OBJECT_ELEM_NV);
+
+    // Cached by address of symbol
+    CU_ASSERT(cupkee_prop_set_sym(obj->entry, sym, CUPKEE_OBJECT_ELEM_INT, 9) == 1);
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, sym, &v) == CUPKEE_OBJECT_ELEM_INT && v == 9);
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, sym, &v) == CUPKEE_OBJECT_ELEM_INT && v == 9);
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, "dynamic", &v) == CUPKEE_OBJECT_ELEM_INT && v == 7);
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, "dynamic", &v) == CUPKEE_OBJECT_ELEM_INT && v == 7);
+
+    // Key buffer freed and reused by other name, cached index is not taken
+    CU_ASSERT_FATAL(NULL != (name = cupkee_malloc(8)));
+    strcpy(name, "alpha");
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, name, &v) == CUPKEE_OBJECT_ELEM_INT && v == 9);
+    cupkee_free(name);
+    CU_ASSERT_FATAL(NULL != (name = cupkee_malloc(8)));
+    strcpy(name, "beta");
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, name, &v) == CUPKEE_OBJECT_ELEM_STR && !strcmp((char *)v, "b"));
+    CU_ASSERT(cupkee_prop_set_sym(obj->entry, name, CUPKEE_OBJECT_ELEM_INT, 1) == 0);
+    strcpy(name, "delta");
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, name, &v) == CUPKEE_OBJECT_ELEM_NV);
+    strcpy(name, "dynamic");
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, name, &v) == CUPKEE_OBJECT_ELEM_INT && v == 7);
+    strcpy(name, "alpha");
+    CU_ASSERT(cupkee_prop_get_sym(obj->entry, name, &v) == CUPKEE_OBJECT_ELEM_INT && v == 9);
+    cupkee_free(name);
+
+    // Not interned key still works on uncached path
+    strcpy(key, "beta");
+    CU_ASSERT(cupkee_prop_get(obj->entry, key, &v) == CUPKEE_OBJECT_ELEM_STR);
+    strcpy(key, "alpha");
+    CU_ASSERT(cupkee_prop_get(obj->entry, key, &v) == CUPKEE_OBJECT_ELEM_INT && v == 9);
+
+    cupkee_object_destroy(obj);
+}
+
 CU_pSuite test_sys_object(void)
 {
     CU_pSuite suite = CU_add_suite("system object", test_setup, test_clean);
@@ -49,6 +380,11 @@ CU_pSuite test_sys_object(void)
     if (suite) {
         CU_add_test(suite, "object register  ", test_register);
         CU_add_test(suite, "object read      ", test_read);
+        CU_add_test(suite, "object id        ", test_id);
+        CU_add_test(suite, "object coalesce  ", test_event_coalesce);
+        CU_add_test(suite, "object ref       ", test_ref);
+        CU_add_test(suite, "object sweep     ", test_sweep);
+        CU_add_test(suite, "object prop      ", test_prop);
     }
 
     return suite;
@@ -107,6 +107,32 @@ static void test_group(void)
     CU_ASSERT(0 == cupkee_release(grp));
 }
 
+static void test_group_bound(void)
+{
+    void *grp;
+    intptr_t v;
+    int i;
+
+    // Leave valid pin numbers in the block the next group will reuse,
+    // past the bytes the allocator links its free blocks with
+    CU_ASSERT(NULL != (grp = cupkee_pin_group_create()));
+    for (i = 0; i < 16; i++) {
+        CU_ASSERT(i + 1 == cupkee_pin_group_push(grp, i % 4));
+    }
+    CU_ASSERT(0 == cupkee_release(grp));
+
+    CU_ASSERT(NULL != (grp = cupkee_pin_group_create()));
+    CU_ASSERT(1 == cupkee_pin_group_push(grp, 3));
+
+    CU_ASSERT(CUPKEE_OBJECT_ELEM_INT == cupkee_elem_get(grp, 0, &v));
+    for (i = 1; i < 16; i++) {
+        CU_ASSERT(CUPKEE_OBJECT_ELEM_NV == cupkee_elem_get(grp, i, &v));
+        CU_ASSERT(0 > cupkee_elem_set(grp, i, CUPKEE_OBJECT_ELEM_INT, 1));
+    }
+
+    CU_ASSERT(0 == cupkee_release(grp));
+}
+
 static int changed_pin;
 static int change_type;
 
@@ -189,6 +215,7 @@ CU_pSuite test_sys_pin(void)
     if (suite) {
         CU_add_test(suite, "pin basic        ", test_basic);
         CU_add_test(suite, "pin group        ", test_group);
+        CU_add_test(suite, "pin group bound  ", test_group_bound);
         CU_add_test(suite, "pin event        ", test_event);
     }
 
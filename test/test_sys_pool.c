@@ -0,0 +1,189 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+static const cupkee_pinmap_t test_pool_pinmap[2] = {
+    {0, 0}, // Bank 0, port 0
+    {0, 1}, // Bank 0, port 1
+};
+
+static int test_setup(void)
+{
+    TU_pre_init();
+
+    cupkee_pin_map(2, test_pool_pinmap);
+    return 0;
+}
+
+static int test_clean(void)
+{
+    return TU_pre_deinit();
+}
+
+typedef struct test_obj_t {
+    void    *link;
+    uint32_t data[3];
+} test_obj_t;
+
+static void test_static(void)
+{
+    cupkee_pool_t pool;
+    test_obj_t storage[4], *obj[5];
+    int i;
+
+    CU_ASSERT(0 > cupkee_pool_init(NULL, sizeof(test_obj_t), 0, storage, sizeof(storage)));
+    CU_ASSERT(0 > cupkee_pool_init(&pool, 0, 0, storage, sizeof(storage)));
+
+    CU_ASSERT(0 == cupkee_pool_init(&pool, sizeof(test_obj_t), 0, storage, sizeof(storage)));
+    CU_ASSERT(pool.total == 4 && pool.used == 0);
+
+    for (i = 0; i < 4; i++) {
+        CU_ASSERT_FATAL(NULL != (obj[i] = cupkee_pool_get(&pool)));
+        CU_ASSERT(obj[i] >= storage && obj[i] < storage + 4);
+    }
+    CU_ASSERT(NULL == cupkee_pool_get(&pool));
+    CU_ASSERT(pool.used == 4 && pool.peak == 4 && pool.refill == 0);
+
+    cupkee_pool_put(&pool, obj[2]);
+    CU_ASSERT(obj[2] == cupkee_pool_get(&pool));
+
+    for (i = 0; i < 4; i++) {
+        cupkee_pool_put(&pool, obj[i]);
+    }
+    CU_ASSERT(pool.used == 0 && pool.peak == 4 && pool.total == 4);
+}
+
+static void test_grow(void)
+{
+    cupkee_pool_t pool;
+    cupkee_memory_info_t info;
+    test_obj_t *obj[8];
+    int i, page_free;
+    uint32_t slab_used;
+
+    CU_ASSERT(0 == cupkee_pool_init(&pool, sizeof(test_obj_t), 3, NULL, 0));
+    CU_ASSERT(pool.total == 0);
+
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT_FATAL(NULL != (obj[i] = cupkee_pool_get(&pool)));
+        obj[i]->data[0] = i;
+    }
+    CU_ASSERT(pool.total == 9 && pool.used == 8 && pool.refill == 3);
+
+    for (i = 0; i < 8; i++) {
+        cupkee_pool_put(&pool, obj[i]);
+    }
+
+    cupkee_memory_info(&info);
+    page_free = info.page_free;
+    slab_used = info.slab_used;
+
+    // Steady state: no more refill
+    for (i = 0; i < 100; i++) {
+        void *a = cupkee_pool_get(&pool);
+        void *b = cupkee_pool_get(&pool);
+
+        CU_ASSERT(a && b);
+        cupkee_pool_put(&pool, a);
+        cupkee_pool_put(&pool, b);
+    }
+    CU_ASSERT(pool.refill == 3 && pool.peak == 8);
+
+    cupkee_memory_info(&info);
+    CU_ASSERT(page_free == info.page_free && slab_used == info.slab_used);
+}
+
+static void test_timeout_handle(int drop, void *param)
+{
+    (void) drop;
+    (void) param;
+}
+
+static void test_process_task(void *entry)
+{
+    cupkee_process_done(entry);
+}
+
+static int test_pin_handle(void *entry, int event, intptr_t param)
+{
+    (void) entry;
+    (void) event;
+    (void) param;
+    return 0;
+}
+
+static void test_steady_state(void)
+{
+    cupkee_memory_info_t info;
+    cupkee_timeout_t *t[4];
+    int i, n, page_free;
+    uint32_t slab_used;
+
+    // Warm up pools of kernel objects
+    for (n = 0; n < 4; n++) {
+        CU_ASSERT_FATAL(NULL != (t[n] = cupkee_timeout_register(10, 0, test_timeout_handle, NULL)));
+    }
+    for (n = 0; n < 4; n++) {
+        cupkee_timeout_unregister(t[n]);
+    }
+    CU_ASSERT(0 == cupkee_pin_listen(0, CUPKEE_EVENT_PIN_RISING, test_pin_handle, NULL));
+    CU_ASSERT(0 == cupkee_pin_ignore(0));
+    CU_ASSERT(0 == cupkee_process_start(test_process_task, 0, NULL));
+
+    cupkee_memory_info(&info);
+    page_free = info.page_free;
+    slab_used = info.slab_used;
+
+    for (i = 0; i < 1000; i++) {
+        for (n = 0; n < 4; n++) {
+            CU_ASSERT_FATAL(NULL != (t[n] = cupkee_timeout_register(10, 0, test_timeout_handle, NULL)));
+        }
+        CU_ASSERT(0 == cupkee_pin_listen(0, CUPKEE_EVENT_PIN_RISING, test_pin_handle, NULL));
+        CU_ASSERT(0 == cupkee_pin_listen(1, CUPKEE_EVENT_PIN_FALLING, test_pin_handle, NULL));
+        CU_ASSERT(0 == cupkee_process_start(test_process_task, i, NULL));
+
+        for (n = 0; n < 4; n++) {
+            cupkee_timeout_unregister(t[n]);
+        }
+        CU_ASSERT(0 == cupkee_pin_ignore(0));
+        CU_ASSERT(0 == cupkee_pin_ignore(1));
+    }
+
+    cupkee_memory_info(&info);
+    CU_ASSERT(page_free == info.page_free);
+    CU_ASSERT(slab_used == info.slab_used);
+}
+
+CU_pSuite test_sys_pool(void)
+{
+    CU_pSuite suite = CU_add_suite("system pool", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "pool static      ", test_static);
+        CU_add_test(suite, "pool grow        ", test_grow);
+        CU_add_test(suite, "pool steady state", test_steady_state);
+    }
+
+    return suite;
+}
+
@@ -216,6 +216,7 @@ static void test_stream_event(void)
     CU_ASSERT(16 == cupkee_stream_push(s, 32, buf))
     CU_ASSERT(1 == TU_object_event_dispatch());
     CU_ASSERT(mock_curr_id == id && mock_curr_event == CUPKEE_EVENT_DATA);
+    CU_ASSERT(cupkee_event_data() == 32);   // bytes buffered
 
     CU_ASSERT(32 == cupkee_stream_write(s, 32, buf))
     CU_ASSERT(31 == cupkee_stream_pull(s, 31, buf))
@@ -224,6 +225,30 @@ static void test_stream_event(void)
     CU_ASSERT(1 == cupkee_stream_pull(s, 32, buf))
     CU_ASSERT(1 == TU_object_event_dispatch());
     CU_ASSERT(mock_curr_id == id && mock_curr_event == CUPKEE_EVENT_DRAIN);
+    CU_ASSERT(cupkee_event_data() == 32);   // space to write
+
+    CU_ASSERT(0 == cupkee_stream_deinit(s));
+}
+
+static void test_stream_event_merge(void)
+{
+    int id;
+    cupkee_stream_t *s;
+    uint8_t buf[32];
+
+    CU_ASSERT(0 <= (id = cupkee_create_id(tag)));
+    CU_ASSERT(NULL != (s = (cupkee_stream_t *) cupkee_id_entry(id, tag)));
+    CU_ASSERT(0 == cupkee_stream_init(s, id, 32, 32, mock_read, mock_write));
+
+    cupkee_stream_listen(s, CUPKEE_EVENT_DATA);
+
+    // Second push is coalesced, its byte count is delivered
+    CU_ASSERT(17 == cupkee_stream_push(s, 17, buf))
+    CU_ASSERT(8 == cupkee_stream_push(s, 8, buf))
+    CU_ASSERT(1 == TU_object_event_dispatch());
+    CU_ASSERT(mock_curr_id == id && mock_curr_event == CUPKEE_EVENT_DATA);
+    CU_ASSERT(cupkee_event_data() == 25);
+    CU_ASSERT(0 == TU_object_event_dispatch());
 
     CU_ASSERT(0 == cupkee_stream_deinit(s));
 }
@@ -238,6 +263,7 @@ CU_pSuite test_sys_stream(void)
         CU_add_test(suite, "stream write     ", test_stream_write);
         CU_add_test(suite, "stream sync io   ", test_stream_sync);
         CU_add_test(suite, "stream event     ", test_stream_event);
+        CU_add_test(suite, "stream event data", test_stream_event_merge);
     }
 
     return suite;
@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "test.h"
 #include <cupkee.h>
@@ -273,6 +274,331 @@ static void test_timeout_clear(void)
     return;
 }
 
+static void test_idle(void)
+{
+    cupkee_timeout_t *t1;
+    int loops;
+
+    _cupkee_systicks = 0;
+    cupkee_event_reset();
+    hw_mock_idle_reset();
+
+    v1[0] = 0; v1[1] = 0;
+
+    // Nothing scheduled: longest sleep
+    cupkee_idle();
+    CU_ASSERT(hw_mock_idle_calls() == 1);
+    CU_ASSERT(hw_mock_idle_ticks() == CUPKEE_IDLE_TICKS_MAX);
+    cupkee_poll();
+
+    // Sleep right to the deadline, instead of spinning each tick
+    _cupkee_systicks = 0;
+    hw_mock_idle_reset();
+    CU_ASSERT_FATAL((t1 = cupkee_timeout_register(100, 0, test_handle, &v1)) != NULL);
+
+    for (loops = 0; loops < 1000 && v1[0] == 0; loops++) {
+        cupkee_poll();
+        cupkee_idle();
+    }
+    CU_ASSERT(v1[0] == 1 && v1[1] == 1);
+    CU_ASSERT(loops == 2);
+    CU_ASSERT(hw_mock_idle_ticks() >= 100);
+    CU_ASSERT(hw_mock_idle_calls() == 2);
+    cupkee_poll();
+
+    // No sleep while events pending
+    hw_mock_idle_reset();
+    CU_ASSERT_FATAL((t1 = cupkee_timeout_register(100, 0, test_handle, &v1)) != NULL);
+    cupkee_event_post_pin(0, CUPKEE_EVENT_PIN_RISING);
+    cupkee_idle();
+    CU_ASSERT(hw_mock_idle_calls() == 0);
+    cupkee_poll();
+    cupkee_idle();
+    CU_ASSERT(hw_mock_idle_calls() == 1 && hw_mock_idle_ticks() == 100);
+
+    cupkee_timeout_clear_all();
+    cupkee_event_reset();
+}
+
+static void test_far(void)
+{
+    cupkee_timeout_t *t1, *t2;
+
+    _cupkee_systicks = 0;
+
+    v1[0] = 0; v1[1] = 0;
+    v2[0] = 0; v2[1] = 0;
+
+    // Beyond the whole wheel span, parked and cascaded again
+    CU_ASSERT_FATAL((t1 = cupkee_timeout_register(1000000, 0, test_handle, &v1)) != NULL);
+    CU_ASSERT_FATAL((t2 = cupkee_timeout_register(5000, 1, test_handle, &v2)) != NULL);
+    CU_ASSERT(cupkee_timeout_next(0) == 5000);
+
+    // Ticks slept over are caught up by sync
+    _cupkee_systicks = 4999;
+    cupkee_timeout_sync(_cupkee_systicks);
+    CU_ASSERT(v2[0] == 0);
+    CU_ASSERT(cupkee_timeout_next(_cupkee_systicks) == 1);
+
+    _cupkee_systicks = 999999;
+    cupkee_timeout_sync(_cupkee_systicks);
+    CU_ASSERT(v1[0] == 0 && v1[1] == 0);
+    CU_ASSERT(v2[0] == 1 && v2[1] == 0);    // Periods missed are coalesced
+    CU_ASSERT(cupkee_timeout_next(_cupkee_systicks) == 1);
+
+    cupkee_timeout_sync(++_cupkee_systicks);
+    CU_ASSERT(v1[0] == 1 && v1[1] == 1);
+    CU_ASSERT(v2[0] == 2 && v2[1] == 0);    // Still on schedule
+    CU_ASSERT(cupkee_timeout_next(_cupkee_systicks) == 5000);
+
+    CU_ASSERT(cupkee_timeout_clear_with_id(t2->id) == 1);
+    CU_ASSERT(v2[1] == 1);
+    CU_ASSERT(cupkee_timeout_next(_cupkee_systicks) == CUPKEE_TICKS_INFINITE);
+}
+
+static uint32_t missed[3];
+
+static void policy_handle(int drop, void *param)
+{
+    int *pv = (int *) param;
+
+    if (drop) {
+        pv[1] += 1;
+    } else {
+        pv[0] += 1;
+        missed[pv == v1 ? 0 : pv == v2 ? 1 : 2] += cupkee_timeout_missed();
+    }
+}
+
+static void test_policy(void)
+{
+    _cupkee_systicks = 0;
+
+    v1[0] = 0; v1[1] = 0;
+    v2[0] = 0; v2[1] = 0;
+    v3[0] = 0; v3[1] = 0;
+    memset(missed, 0, sizeof(missed));
+
+    CU_ASSERT_FATAL(NULL != cupkee_timeout_register(10, CUPKEE_FLAG_REPEAT, policy_handle, &v1));
+    CU_ASSERT_FATAL(NULL != cupkee_timeout_register(10, CUPKEE_FLAG_REPEAT | CUPKEE_TIMEOUT_CATCHUP, policy_handle, &v2));
+    CU_ASSERT_FATAL(NULL != cupkee_timeout_register(10, CUPKEE_FLAG_REPEAT | CUPKEE_TIMEOUT_SKIP, policy_handle, &v3));
+
+    // Late sync never drift the periods
+    while (_cupkee_systicks < 1000) {
+        _cupkee_systicks += 7;
+        cupkee_timeout_sync(_cupkee_systicks);
+    }
+    CU_ASSERT(v1[0] == 100 && v2[0] == 100 && v3[0] == 100);
+    CU_ASSERT(cupkee_timeout_next(_cupkee_systicks) == 1010 - _cupkee_systicks);
+
+    // Stall of several periods
+    _cupkee_systicks = 1055;
+    cupkee_timeout_sync(_cupkee_systicks);
+    CU_ASSERT(v1[0] == 101 && missed[0] == 4);
+    CU_ASSERT(v2[0] == 105 && missed[1] == 0);
+    CU_ASSERT(v3[0] == 101 && missed[2] == 0);
+
+    // Back on the original schedule
+    _cupkee_systicks = 1060;
+    cupkee_timeout_sync(_cupkee_systicks);
+    CU_ASSERT(v1[0] == 102 && v2[0] == 106 && v3[0] == 102);
+
+    // Policy bits are not part of the type
+    CU_ASSERT(cupkee_timeout_clear_with_flags(CUPKEE_FLAG_REPEAT) == 3);
+    CU_ASSERT(cupkee_timeout_clear_all() == 0);
+
+    // Slack is kept within the period, never counted as missed
+    _cupkee_systicks = 0;
+    v1[0] = 0;
+    missed[0] = 0;
+    CU_ASSERT_FATAL(NULL != cupkee_timeout_register_ext(10, 30, CUPKEE_FLAG_REPEAT, policy_handle, &v1));
+    while (_cupkee_systicks < 1000) {
+        cupkee_timeout_sync(++_cupkee_systicks);
+    }
+    CU_ASSERT(v1[0] == 99 && missed[0] == 0);   // The one due at 1000 wait in its slack
+    CU_ASSERT(cupkee_timeout_clear_all() == 1);
+}
+
+#define TABLE_TIMERS    (CUPKEE_TIMEOUT_NUM_DEF * 8)
+
+static void test_table(void)
+{
+    cupkee_memory_info_t info;
+    cupkee_timeout_t *t;
+    int id, i, page_free;
+
+    _cupkee_systicks = 0;
+    v1[0] = 0; v1[1] = 0;
+
+    CU_ASSERT_FATAL((t = cupkee_timeout_register(10, 0, test_handle, &v1)) != NULL);
+    id = t->id;
+    CU_ASSERT(cupkee_timeout_clear_with_id(id) == 1);
+    CU_ASSERT(cupkee_timeout_clear_with_id(id) == 0);
+
+    // Map grows beyond the default size, the slot of id is recycled
+    for (i = 0; i < TABLE_TIMERS; i++) {
+        CU_ASSERT_FATAL(cupkee_timeout_register(10, 0, test_handle, &v1) != NULL);
+    }
+
+    // Stale id never hit the new timer
+    CU_ASSERT(cupkee_timeout_clear_with_id(id) == 0);
+    CU_ASSERT(cupkee_timeout_clear_with_id(cupkee_timeout_slot(id)) == 0);
+    CU_ASSERT(v1[1] == 1);
+
+    CU_ASSERT(cupkee_timeout_clear_all() == TABLE_TIMERS);
+    CU_ASSERT(v1[1] == TABLE_TIMERS + 1);
+
+    // Released timers are reused, allocation free up to the peak
+    cupkee_memory_info(&info);
+    page_free = info.page_free;
+
+    for (i = 0; i < TABLE_TIMERS; i++) {
+        CU_ASSERT_FATAL(cupkee_timeout_register(10, 0, test_handle, &v1) != NULL);
+    }
+    CU_ASSERT(cupkee_timeout_clear_all() == TABLE_TIMERS);
+
+    cupkee_memory_info(&info);
+    CU_ASSERT(page_free == info.page_free);
+}
+
+static int slack_fired, slack_early, slack_late;
+static uint32_t slack_max;
+
+static void slack_handle(int drop, void *param)
+{
+    uint32_t wait = (uintptr_t) param;
+
+    if (!drop) {
+        slack_fired++;
+        if (_cupkee_systicks < wait) {
+            slack_early++;
+        }
+        if (_cupkee_systicks > wait + slack_max) {
+            slack_late++;
+        }
+    }
+}
+
+static int slack_workload(uint32_t slack)
+{
+    int i, loops;
+
+    _cupkee_systicks = 0;
+    cupkee_event_reset();
+    hw_mock_idle_reset();
+
+    slack_fired = 0;
+    slack_early = 0;
+    slack_late = 0;
+    slack_max = slack;
+
+    // Timers expired a few ticks apart
+    for (i = 0; i < 16; i++) {
+        uint32_t wait = 100 + i * 3;
+        CU_ASSERT_FATAL(NULL != cupkee_timeout_register_ext(wait, slack, 0, slack_handle, (void *)(uintptr_t)wait));
+    }
+
+    for (loops = 0; loops < 1000 && slack_fired < 16; loops++) {
+        cupkee_poll();
+        cupkee_idle();
+    }
+
+    CU_ASSERT(slack_fired == 16);
+    CU_ASSERT(slack_early == 0);
+    CU_ASSERT(slack_late == 0);
+    cupkee_poll();
+
+    return hw_mock_idle_calls();
+}
+
+static void test_slack(void)
+{
+    int strict = slack_workload(0);
+    int batched = slack_workload(64);
+
+    CU_ASSERT(strict >= 16);
+    CU_ASSERT(batched <= 3);
+
+    cupkee_event_reset();
+}
+
+#define LOAD_TIMERS     (CUPKEE_TIMEOUT_MAX < 1000 ? CUPKEE_TIMEOUT_MAX : 1000)
+#define LOAD_TICKS      20000
+
+static int load_fired, load_late;
+
+static void load_handle(int drop, void *param)
+{
+    uint32_t wait = (uintptr_t) param;
+
+    if (!drop) {
+        load_fired++;
+        if (_cupkee_systicks % wait) {
+            load_late++;
+        }
+    }
+}
+
+/*
+ * Run timers of spread waits for ticks, a repeat timer every 8 timers.
+ * Return nanoseconds of host clock spent in cupkee_timeout_sync.
+ */
+static double timeout_load(int timers, uint32_t ticks)
+{
+    struct timespec t0, t1;
+    int i, expect = 0, repeats = 0;
+
+    // Room for timers
+    hw_mock_init(2 * 1024 * 1024);
+    cupkee_init(NULL);
+    cupkee_start();
+
+    _cupkee_systicks = 0;
+    load_fired = 0;
+    load_late = 0;
+
+    for (i = 0; i < timers; i++) {
+        uint32_t wait = 1 + (i * 7919) % ticks;
+        int repeat = (i % 8) == 0;
+
+        CU_ASSERT_FATAL(NULL != cupkee_timeout_register(wait, repeat, load_handle, (void *)(uintptr_t)wait));
+        expect += repeat ? ticks / wait : 1;
+        repeats += repeat;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (_cupkee_systicks < ticks) {
+        cupkee_timeout_sync(++_cupkee_systicks);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    CU_ASSERT(load_fired == expect);
+    CU_ASSERT(load_late == 0);
+    CU_ASSERT(cupkee_timeout_clear_all() == repeats);
+
+    TU_pre_init();
+
+    return (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+static void test_load(void)
+{
+    timeout_load(LOAD_TIMERS, LOAD_TICKS);
+}
+
+#ifdef CUPKEE_TEST_BENCH
+// Host benchmark, built by: make test BENCH=1
+#define BENCH_TIMERS    (CUPKEE_TIMEOUT_MAX < 10000 ? CUPKEE_TIMEOUT_MAX : 10000)
+#define BENCH_TICKS     20000
+
+static void test_bench(void)
+{
+    double ns = timeout_load(BENCH_TIMERS, BENCH_TICKS);
+
+    printf("\n    %d timers, %d ticks: %.0f ns/tick ", BENCH_TIMERS, BENCH_TICKS, ns / BENCH_TICKS);
+}
+#endif
+
 CU_pSuite test_sys_timeout(void)
 {
     CU_pSuite suite = CU_add_suite("system timeout", test_setup, test_clean);
@@ -282,6 +608,15 @@ CU_pSuite test_sys_timeout(void)
         CU_add_test(suite, "timeout running  ", test_running);
         CU_add_test(suite, "timeout clear1   ", test_self_clear);
         CU_add_test(suite, "timeout clear2   ", test_timeout_clear);
+        CU_add_test(suite, "timeout idle     ", test_idle);
+        CU_add_test(suite, "timeout far      ", test_far);
+        CU_add_test(suite, "timeout policy   ", test_policy);
+        CU_add_test(suite, "timeout slack    ", test_slack);
+        CU_add_test(suite, "timeout table    ", test_table);
+        CU_add_test(suite, "timeout load     ", test_load);
+#ifdef CUPKEE_TEST_BENCH
+        CU_add_test(suite, "timeout bench    ", test_bench);
+#endif
     }
 
     return suite;
@@ -68,6 +68,7 @@ static void test_timer_request(void)
 static void test_timer_start(void)
 {
     void *timer;
+    intptr_t v;
 
     CU_ASSERT(0 <= (timer = cupkee_timer_request(test_timer_counter, 0)));
 
@@ -76,6 +77,8 @@ static void test_timer_start(void)
 
     hw_mock_timer_duration_set(7);
     CU_ASSERT(7 == cupkee_timer_duration(timer));
+    CU_ASSERT(cupkee_prop_get(timer, "duration", &v) == CUPKEE_OBJECT_ELEM_INT && v == 7);
+    CU_ASSERT(cupkee_prop_get(timer, "period", &v) == CUPKEE_OBJECT_ELEM_NV);
 
     CU_ASSERT(0 == cupkee_timer_stop(timer));
     CU_ASSERT(TU_object_event_dispatch());
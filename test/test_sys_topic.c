@@ -0,0 +1,153 @@
+/* GPLv2 License
+ *
+ * Copyright (C) 2016-2018 Lixing Ding <ding.lixing@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+static int test_setup(void)
+{
+    return TU_pre_init();
+}
+
+static int test_clean(void)
+{
+    return TU_pre_deinit();
+}
+
+static int      topic_calls[CUPKEE_TOPIC_SUBSCRIBERS];
+static int      topic_drops[CUPKEE_TOPIC_SUBSCRIBERS];
+static uint32_t topic_value;
+static int      topic_self_sid;
+
+static int topic_handler(void *entry, int topic, intptr_t value)
+{
+    int i = (intptr_t)entry;
+
+    if (topic == CUPKEE_TOPIC_DROP) {
+        topic_drops[i]++;
+    } else {
+        topic_calls[i]++;
+        topic_value = value;
+    }
+    return 0;
+}
+
+static int topic_once_handler(void *entry, int topic, intptr_t value)
+{
+    (void) value;
+
+    if (topic != CUPKEE_TOPIC_DROP) {
+        topic_calls[(intptr_t)entry]++;
+        cupkee_topic_unsubscribe(topic_self_sid);
+    }
+    return 0;
+}
+
+static void topic_reset(void)
+{
+    cupkee_topic_setup();
+    cupkee_event_reset();
+    memset(topic_calls, 0, sizeof(topic_calls));
+    memset(topic_drops, 0, sizeof(topic_drops));
+    topic_value = 0;
+}
+
+static void test_fanout(void)
+{
+    cupkee_event_t e;
+    intptr_t i;
+    int sid[8];
+
+    topic_reset();
+
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT((sid[i] = cupkee_topic_subscribe(3, topic_handler, (void *)i)) >= 0);
+    }
+    CU_ASSERT(0 <= cupkee_topic_subscribe(4, topic_handler, (void *)8));
+    CU_ASSERT(8 == cupkee_topic_subscribers(3));
+
+    // One queue entry for all subscribers
+    CU_ASSERT(CUPKEE_OK == cupkee_topic_publish(3, 1234));
+    CU_ASSERT(1 == cupkee_event_take(&e));
+    CU_ASSERT(e.type == EVENT_TOPIC && e.which == 3 && e.data == 1234);
+    CU_ASSERT(0 == cupkee_event_take(&e));
+
+    CU_ASSERT(CUPKEE_OK == cupkee_topic_publish(3, 1234));
+    cupkee_event_poll();
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT(topic_calls[i] == 1);
+    }
+    CU_ASSERT(topic_calls[8] == 0);
+    CU_ASSERT(topic_value == 1234);
+
+    // Unsubscribed handler get drop
+    CU_ASSERT(CUPKEE_OK == cupkee_topic_unsubscribe(sid[0]));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_topic_unsubscribe(sid[0]));
+    CU_ASSERT(topic_drops[0] == 1);
+    CU_ASSERT(CUPKEE_OK == cupkee_topic_publish(3, 5));
+    cupkee_event_poll();
+    CU_ASSERT(topic_calls[0] == 1 && topic_calls[1] == 2);
+
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_topic_publish(CUPKEE_TOPIC_MAX, 0));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_topic_subscribe(CUPKEE_TOPIC_MAX, topic_handler, NULL));
+    CU_ASSERT(-CUPKEE_EINVAL == cupkee_topic_subscribe(0, NULL, NULL));
+}
+
+static void test_table(void)
+{
+    intptr_t i;
+
+    topic_reset();
+
+    for (i = 0; i < CUPKEE_TOPIC_SUBSCRIBERS; i++) {
+        CU_ASSERT(i == cupkee_topic_subscribe(i % CUPKEE_TOPIC_MAX, topic_handler, (void *)i));
+    }
+    CU_ASSERT(-CUPKEE_ERESOURCE == cupkee_topic_subscribe(0, topic_handler, NULL));
+
+    // Slot reused
+    CU_ASSERT(CUPKEE_OK == cupkee_topic_unsubscribe(5));
+    CU_ASSERT(5 == cupkee_topic_subscribe(1, topic_handler, (void *)5));
+
+    // Handler unsubscribe itself in dispatch
+    topic_reset();
+    CU_ASSERT(0 <= (topic_self_sid = cupkee_topic_subscribe(2, topic_once_handler, (void *)0)));
+    CU_ASSERT(0 <= cupkee_topic_subscribe(2, topic_handler, (void *)1));
+    cupkee_topic_publish(2, 0);
+    cupkee_topic_publish(2, 0);
+    cupkee_event_poll();
+    CU_ASSERT(topic_calls[0] == 1 && topic_calls[1] == 2);
+    CU_ASSERT(1 == cupkee_topic_subscribers(2));
+
+    topic_reset();
+}
+
+CU_pSuite test_sys_topic(void)
+{
+    CU_pSuite suite = CU_add_suite("system topic", test_setup, test_clean);
+
+    if (suite) {
+        CU_add_test(suite, "topic fan-out    ", test_fanout);
+        CU_add_test(suite, "topic table      ", test_table);
+    }
+
+    return suite;
+}
+